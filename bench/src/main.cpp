@@ -0,0 +1,460 @@
+// FleetBench measures the layout, hit-testing and drawing paths of the Fleet
+// widgets. Nothing is shown: widgets are drawn into an Fl_Image_Surface. FLTK
+// still needs a display for fonts and offscreen buffers, so on a machine
+// without one the benchmarks are run under Xvfb:
+//
+//     xvfb-run ./FleetBench --sizes=1000,100000 --json=results.json
+//
+// Every result is reported as time and heap allocations per operation. What
+// an operation is depends on the benchmark, see the comments below.
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Image_Surface.H>
+#include <FL/fl_draw.H>
+
+#include "FLE/Fle_Listview.hpp"
+#include "FLE/Fle_Listview_Item.hpp"
+#include "FLE/Fle_Dock_Host.hpp"
+#include "FLE/Fle_Dock_Group.hpp"
+#include "FLE/Fle_TileEx.hpp"
+#include "FLE/Fle_Frame_Scheduler.hpp"
+#include "FLE/Fle_Instrumentation.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_W 1024
+#define BENCH_H 768
+
+// Every allocation of the process is counted, including the ones made by FLTK
+static std::atomic<long long> s_allocations(0);
+static std::atomic<long long> s_allocatedBytes(0);
+
+void* operator new(size_t size)
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	s_allocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+
+	void* p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+struct Bench_Result
+{
+	std::string name;
+	std::string variant;
+	long long items;
+	long long ops;
+	double nsPerOp;
+	double allocsPerOp;
+	double bytesPerOp;
+};
+
+static std::vector<Bench_Result> s_results;
+
+// Times a run of operations and counts the allocations made during it
+class Bench_Timer
+{
+	std::chrono::steady_clock::time_point m_start;
+	long long m_allocations;
+	long long m_bytes;
+
+public:
+	void start()
+	{
+		m_allocations = s_allocations.load();
+		m_bytes = s_allocatedBytes.load();
+		m_start = std::chrono::steady_clock::now();
+	}
+
+	void stop(const char* name, const char* variant, long long items, long long ops)
+	{
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
+
+		Bench_Result result;
+		result.name = name;
+		result.variant = variant;
+		result.items = items;
+		result.ops = ops;
+		result.nsPerOp = ns / ops;
+		result.allocsPerOp = (double)(s_allocations.load() - m_allocations) / ops;
+		result.bytesPerOp = (double)(s_allocatedBytes.load() - m_bytes) / ops;
+		s_results.push_back(result);
+
+		printf("%-22s %-12s %9lld %14.1f ns/op %10.2f allocs/op %12.1f B/op\n", name, variant, items, result.nsPerOp, result.allocsPerOp, result.bytesPerOp);
+		fflush(stdout);
+	}
+};
+
+// Deterministic, so runs can be compared
+static unsigned int s_seed = 2463534242u;
+
+static unsigned int next_random()
+{
+	s_seed ^= s_seed << 13;
+	s_seed ^= s_seed >> 17;
+	s_seed ^= s_seed << 5;
+
+	return s_seed;
+}
+
+// Number of times to repeat an operation on all items, so small lists run long enough to measure
+static int repeats(long long items, long long budget, int most)
+{
+	long long r = budget / (items > 0 ? items : 1);
+
+	return (int)(r < 1 ? 1 : (r > most ? most : r));
+}
+
+class Bench_Item : public Fle_Listview_Item
+{
+	int m_size;
+	int m_owner;
+
+protected:
+	bool is_greater(Fle_Listview_Item* other, int property) override
+	{
+		Bench_Item* o = (Bench_Item*)other;
+		if (property == 0) return m_size > o->m_size;
+		if (property == 1) return m_owner > o->m_owner;
+
+		return Fle_Listview_Item::is_greater(other, property);
+	}
+
+	void draw_property(int property, int X, int Y, int W, int H) override
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "%d", property == 0 ? m_size : m_owner);
+
+		fl_color(textcolor());
+		fl_draw(text, X, Y, W, H, FL_ALIGN_LEFT);
+	}
+
+public:
+	Bench_Item(const char* name, int size, int owner) : Fle_Listview_Item(name)
+	{
+		m_size = size;
+		m_owner = owner;
+	}
+};
+
+static void draw_widget(Fl_Image_Surface* surface, Fl_Widget* widget)
+{
+	Fl_Surface_Device::push_current(surface);
+	surface->draw(widget);
+	Fl_Surface_Device::pop_current();
+}
+
+static const char* mode_name(Fle_Listview_Display_Mode mode)
+{
+	switch (mode)
+	{
+	case FLE_LISTVIEW_DISPLAY_ICONS: return "icons";
+	case FLE_LISTVIEW_DISPLAY_SMALL_ICONS: return "small_icons";
+	case FLE_LISTVIEW_DISPLAY_DETAILS: return "details";
+	case FLE_LISTVIEW_DISPLAY_LIST: return "list";
+	case FLE_LISTVIEW_DISPLAY_TOOLBOX: return "toolbox";
+	}
+
+	return "";
+}
+
+static void bench_listview(Fl_Image_Surface* surface, int count, Fle_Listview_Display_Mode mode)
+{
+	const char* variant = mode_name(mode);
+	Bench_Timer timer;
+
+	Fl_Double_Window* window = new Fl_Double_Window(BENCH_W, BENCH_H);
+	Fle_Listview* listview = new Fle_Listview(0, 0, BENCH_W, BENCH_H, "");
+	listview->set_property_widths({ 82, 82 });
+	listview->set_property_order({ 1, 0 });
+	listview->add_property_name("Size");
+	listview->add_property_name("Owner");
+	listview->set_display_mode(mode);
+	window->end();
+
+	// The items are made up front, only adding them is measured
+	std::vector<Fle_Listview_Item*> items;
+	items.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "item_%08u.dat", next_random() % 100000000u);
+		items.push_back(new Bench_Item(name, (int)(next_random() % 100000), (int)(next_random() % 64)));
+	}
+
+	// One operation: adding an item
+	timer.start();
+	for (int i = 0; i < count; i++)
+	{
+		listview->add_item(items[i]);
+	}
+	Fle_Frame_Scheduler::flush();
+	timer.stop("listview.add", variant, count, count);
+
+	// One operation: the first draw, which arranges all the items
+	timer.start();
+	draw_widget(surface, listview);
+	timer.stop("listview.arrange", variant, count, 1);
+
+	// One operation: sorting all the items
+	int sorts = repeats(count, 1000000, 20);
+	timer.start();
+	for (int i = 0; i < sorts; i++)
+	{
+		listview->sort_items(i % 2 == 0, i % 2);
+	}
+	timer.stop("listview.sort", variant, count, sorts);
+
+	// One operation: selecting all the items, as Ctrl+A does
+	int selections = repeats(count, 1000000, 20);
+	timer.start();
+	for (int r = 0; r < selections; r++)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			listview->select_item(i, true);
+		}
+
+		// Deselecting is part of the measurement, but cheap next to selecting
+		listview->deselect_all();
+	}
+	Fle_Frame_Scheduler::flush();
+	timer.stop("listview.select_all", variant, count, selections);
+
+	// One operation: finding the item under a point in the widget
+	int hits = 100000;
+	timer.start();
+	for (int i = 0; i < hits; i++)
+	{
+		listview->get_item_at(next_random() % BENCH_W, next_random() % BENCH_H);
+	}
+	timer.stop("listview.hit_test", variant, count, hits);
+
+	// One operation: drawing the whole widget
+	int draws = 50;
+	timer.start();
+	for (int i = 0; i < draws; i++)
+	{
+		draw_widget(surface, listview);
+	}
+	timer.stop("listview.draw", variant, count, draws);
+
+	// One operation: removing an item from the middle of the list
+	int removals = count < 100 ? count : 100;
+	timer.start();
+	for (int i = 0; i < removals; i++)
+	{
+		listview->remove_item(listview->get_item_count() / 2);
+	}
+	Fle_Frame_Scheduler::flush();
+	timer.stop("listview.remove", variant, count, removals);
+
+	listview->clear_items();
+	delete window;
+}
+
+static void bench_dock_host(int groupCount)
+{
+	char variant[32];
+	snprintf(variant, sizeof(variant), "%d_groups", groupCount);
+	Bench_Timer timer;
+
+	Fl_Double_Window* window = new Fl_Double_Window(BENCH_W * 2, BENCH_H * 2);
+	Fle_Dock_Host* host = new Fle_Dock_Host(0, 0, BENCH_W * 2, BENCH_H * 2, "", FLE_DOCK_ALLDIRS);
+	host->add_work_widget(new Fl_Box(0, 0, 0, 0));
+	window->end();
+
+	// Groups go around the host, a few to a line
+	int directions[] = { FLE_DOCK_TOP, FLE_DOCK_RIGHT, FLE_DOCK_BOTTOM, FLE_DOCK_LEFT };
+	for (int i = 0; i < groupCount; i++)
+	{
+		Fle_Dock_Group* group = new Fle_Dock_Group(host, i + 1, "Group", FLE_DOCK_DETACHABLE | FLE_DOCK_FLEXIBLE, directions[i % 4], FLE_DOCK_ALLDIRS, 60, 80, (i / 4) % 3 == 0);
+		Fl_Box* box = new Fl_Box(0, 0, 0, 0);
+		group->add_band_widget(box);
+	}
+	Fle_Frame_Scheduler::flush();
+
+	int layoutSize;
+	int const* const layout = host->save_layout(layoutSize);
+
+	// One operation: loading a saved layout and laying the host out
+	int loads = 200;
+	timer.start();
+	for (int i = 0; i < loads; i++)
+	{
+		host->load_layout(layout);
+		Fle_Frame_Scheduler::flush();
+	}
+	timer.stop("dock_host.load_layout", variant, groupCount, loads);
+
+	// One operation: resizing the host and laying it out
+	int resizes = 500;
+	timer.start();
+	for (int i = 0; i < resizes; i++)
+	{
+		int shrink = (i % 2) * 200;
+		host->resize(0, 0, BENCH_W * 2 - shrink, BENCH_H * 2 - shrink);
+		Fle_Frame_Scheduler::flush();
+	}
+	timer.stop("dock_host.resize", variant, groupCount, resizes);
+
+	delete[] layout;
+	delete window;
+}
+
+static void bench_tile_ex(int columns)
+{
+	char variant[32];
+	snprintf(variant, sizeof(variant), "%d_tiles", columns * columns);
+	Bench_Timer timer;
+
+	// The tiles have to fill the whole TileEx without overlapping
+	Fl_Double_Window* window = new Fl_Double_Window(BENCH_W, BENCH_H);
+	Fle_TileEx* tile = new Fle_TileEx(0, 0, BENCH_W, BENCH_H);
+	for (int row = 0; row < columns; row++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			int X = column * BENCH_W / columns;
+			int Y = row * BENCH_H / columns;
+			Fl_Box* box = new Fl_Box(X, Y, (column + 1) * BENCH_W / columns - X, (row + 1) * BENCH_H / columns - Y);
+			box->box(FL_DOWN_BOX);
+		}
+	}
+	for (int i = 0; i < tile->children(); i++)
+	{
+		Fl_Widget* w = tile->child(i);
+		tile->size_range(w, w->w() / 2, w->h() / 2, w->w() * 2, w->h() * 2, w->w(), w->h());
+	}
+	tile->end();
+	window->end();
+
+	// TileEx finds it's edges on the first resize, which has to keep the size
+	// the tiles were laid out for
+	tile->resize(0, 0, BENCH_W, BENCH_H);
+
+	// One operation: resizing the TileEx
+	int resizes = 200;
+	timer.start();
+	for (int i = 0; i < resizes; i++)
+	{
+		int shrink = (i % 2) * 64;
+		tile->resize(0, 0, BENCH_W - shrink, BENCH_H - shrink);
+	}
+	timer.stop("tile_ex.resize", variant, columns * columns, resizes);
+
+	delete window;
+}
+
+static bool write_json(const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file) return false;
+
+	fprintf(file, "{\n\"instrumentation\": %s,\n\"benchmarks\": [\n", Fle_Instrumentation::is_enabled() ? "true" : "false");
+	for (size_t i = 0; i < s_results.size(); i++)
+	{
+		const Bench_Result& r = s_results[i];
+		fprintf(file, "{\"name\": \"%s\", \"variant\": \"%s\", \"items\": %lld, \"ops\": %lld, \"ns_per_op\": %.1f, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}%s\n",
+			r.name.c_str(), r.variant.c_str(), r.items, r.ops, r.nsPerOp, r.allocsPerOp, r.bytesPerOp, i + 1 < s_results.size() ? "," : "");
+	}
+	fputs("]\n}\n", file);
+
+	bool written = !ferror(file);
+	return fclose(file) == 0 && written;
+}
+
+static void print_usage()
+{
+	printf("Usage: FleetBench [--sizes=N,N,...] [--json=PATH]\n");
+	printf("  --sizes  Listview item counts, 1000,10000,100000,1000000,5000000 by default\n");
+	printf("  --json   Also write the results as JSON to PATH\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> sizes;
+	const char* jsonPath = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--sizes=", 8) == 0)
+		{
+			const char* p = argv[i] + 8;
+			while (*p)
+			{
+				char* end;
+				long size = strtol(p, &end, 10);
+				if (end == p || size <= 0)
+				{
+					print_usage();
+					return 1;
+				}
+				sizes.push_back((int)size);
+				p = *end == ',' ? end + 1 : end;
+			}
+		}
+		else if (strncmp(argv[i], "--json=", 7) == 0)
+		{
+			jsonPath = argv[i] + 7;
+		}
+		else
+		{
+			print_usage();
+			return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (sizes.empty()) sizes = { 1000, 10000, 100000, 1000000, 5000000 };
+
+	// Making the surface opens the display, which measuring text needs
+	Fl_Image_Surface* surface = new Fl_Image_Surface(BENCH_W, BENCH_H);
+
+	Fle_Listview_Display_Mode modes[] = { FLE_LISTVIEW_DISPLAY_ICONS, FLE_LISTVIEW_DISPLAY_SMALL_ICONS, FLE_LISTVIEW_DISPLAY_DETAILS, FLE_LISTVIEW_DISPLAY_LIST, FLE_LISTVIEW_DISPLAY_TOOLBOX };
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		for (int m = 0; m < 5; m++)
+		{
+			bench_listview(surface, sizes[i], modes[m]);
+		}
+	}
+
+	int groupCounts[] = { 8, 16, 32 };
+	for (int i = 0; i < 3; i++)
+	{
+		bench_dock_host(groupCounts[i]);
+	}
+
+	int tileColumns[] = { 4, 16, 32 };
+	for (int i = 0; i < 3; i++)
+	{
+		bench_tile_ex(tileColumns[i]);
+	}
+
+	delete surface;
+
+	if (jsonPath && !write_json(jsonPath))
+	{
+		fprintf(stderr, "Could not write %s\n", jsonPath);
+		return 1;
+	}
+
+	return 0;
+}
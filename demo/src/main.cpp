@@ -354,6 +354,14 @@ protected:
 
 public:
 
+    std::string get_property_text(int i) const override
+    {
+        if (i == 0) return std::to_string(m_sizeKB);
+        if (i == 1) return m_owner;
+
+        return Fle_Listview_Item::get_property_text(i);
+    }
+
     Test_Listview_Item(const char* l, int kb, std::string o) : Fle_Listview_Item(l)
     {
         m_sizeKB = kb;
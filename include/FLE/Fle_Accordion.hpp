@@ -27,12 +27,19 @@ class Fle_Accordion: public Fl_Scroll
     bool m_singleOpen;
     Fl_Pack m_pack;
 
+    /// Frame scheduler callback running the scheduled fit_pack()
+    static void frame_cb(void* data, int work);
+
 public:
     /// CTOR
     Fle_Accordion(int X, int Y, int W, int H, const char* l);
+    /// DTOR
+    ~Fle_Accordion();
     
     /// Fits the pack to the size of the accordion
     void fit_pack();
+    /// Fits the pack once before the next frame, however often it's called until then
+    void schedule_fit_pack();
     /// Adds a group
     /// \param group The group to add
     void add_group(Fle_Accordion_Group* group);
@@ -219,6 +219,8 @@ class Fle_Dock_Host : public Fl_Group
 	void detached_drag(Fle_Dock_Group* group, int screenX, int screenY);
 	/// Calculates the minimum required size for the host based on docked groups and work widget minimums. 
 	void calculate_min_size();
+	/// Frame scheduler callback running the scheduled calculate_min_size(). 
+	static void frame_cb(void* data, int work);
 	/// Resets the preferred size for each group in a line, typically to their current size after interaction. 
 	/// \param line Pointer to the list of groups in the line.
 	void line_reset_preferred_sizes(std::list<Fle_Dock_Group*>* line);
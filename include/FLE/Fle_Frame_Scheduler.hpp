@@ -0,0 +1,68 @@
+#ifndef FLE_FRAME_SCHEDULER_H
+#define FLE_FRAME_SCHEDULER_H
+
+#include <vector>
+
+/// \enum Fle_Frame_Work
+/// Work a widget can schedule for the next frame
+enum Fle_Frame_Work
+{
+	FLE_FRAME_LAYOUT = 1 << 0, ///< Position the children or recalculate sizes
+	FLE_FRAME_PAINT = 1 << 1, ///< Request a redraw
+};
+
+/// Runs the work scheduled by a widget. The second argument holds the
+/// Fle_Frame_Work flags scheduled since the last flush.
+typedef void (Fle_Frame_Callback)(void*, int);
+
+/** \class Fle_Frame_Scheduler
+	\brief Coalesces layout and redraw requests into one flush per event loop iteration.
+
+	Widgets schedule work instead of doing it right away, so a burst of API
+	calls or events costs one layout and one redraw request. The scheduled work
+	is run from a single Fl::add_check() callback, after the events of an event
+	loop iteration have been handled and before the windows are drawn. Each
+	scheduled callback runs once per flush with all the work scheduled for it;
+	work scheduled during the flush is run in the same flush.
+
+	All methods must be called on the FLTK thread. A widget cancels it's work
+	when it's destroyed.
+**/
+class Fle_Frame_Scheduler
+{
+	struct Entry
+	{
+		Fle_Frame_Callback* cb; //< Callback running the work
+		void* data; //< Widget the work is for
+		int work; //< Scheduled Fle_Frame_Work flags
+	};
+
+	static std::vector<Entry> s_entries; //< Scheduled work, at most one entry per widget
+	static std::vector<Entry>* s_flushing; //< Entries being run by flush(), nullptr outside of it
+	static bool s_checkAdded; //< Whether the check callback is installed
+
+	static void check_cb(void* data);
+
+public:
+	/// Schedule work for a widget. Scheduling work for a widget that already
+	/// has work scheduled adds to it.
+	///
+	/// \param cb Callback running the work
+	/// \param data Widget the work is for, passed to the callback
+	/// \param work Fle_Frame_Work flags
+	static void schedule(Fle_Frame_Callback* cb, void* data, int work);
+	/// Cancel the work scheduled for a widget
+	///
+	/// \param data Widget the work is for
+	static void cancel(void* data);
+	/// Get the work scheduled for a widget
+	///
+	/// \param data Widget the work is for
+	/// \return Fle_Frame_Work flags, 0 if nothing is scheduled
+	static int get_scheduled(void* data);
+	/// Run the scheduled work now, for example before reading positions
+	/// that depend on it. Does nothing when called from a scheduled callback.
+	static void flush();
+};
+
+#endif
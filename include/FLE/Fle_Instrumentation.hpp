@@ -0,0 +1,98 @@
+#ifndef FLE_INSTRUMENTATION_H
+#define FLE_INSTRUMENTATION_H
+
+#include <vector>
+#include <chrono>
+
+/// \struct Fle_Instrumentation_Stats
+/// Totals recorded for a named scope or counter
+struct Fle_Instrumentation_Stats
+{
+	const char* name; ///< Name of the scope or counter
+	long long calls; ///< Times the scope was run, or values added to the counter
+	long long totalNs; ///< Time spent in the scope, nested scopes included
+	long long maxNs; ///< Longest single run of the scope
+	long long count; ///< Sum of the values added to the counter
+};
+
+/** \class Fle_Instrumentation
+	\brief Timings and counters of the hot paths of Fleet widgets.
+
+	Recording is compiled in only when the library is built with the
+	FLEET_INSTRUMENTATION CMake option, which defines FLE_INSTRUMENTATION.
+	Otherwise FLE_INSTRUMENT_SCOPE and FLE_INSTRUMENT_COUNT expand to nothing
+	and the query methods find nothing.
+
+	Each scope keeps it's totals and also records a trace event per run, which
+	write_chrome_trace() writes in the Chrome trace event format, to be opened
+	with chrome://tracing or Perfetto. Once FLE_INSTRUMENTATION_MAX_EVENTS
+	events are recorded further events are dropped, the totals keep counting.
+	Recording may happen on any thread.
+**/
+class Fle_Instrumentation
+{
+public:
+	/// Times a scope from construction to destruction, use FLE_INSTRUMENT_SCOPE
+	class Scope
+	{
+		const char* m_name; ///< Name of the scope
+		std::chrono::steady_clock::time_point m_start; ///< Time the scope was entered
+
+	public:
+		Scope(const char* name);
+		~Scope();
+	};
+
+	/// Add a run of a scope, used by Scope
+	///
+	/// \param name Name of the scope, must outlive the instrumentation data
+	/// \param start Time the scope was entered
+	/// \param end Time the scope was left
+	static void add_scope(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+	/// Add a value to a counter, use FLE_INSTRUMENT_COUNT
+	///
+	/// \param name Name of the counter, must outlive the instrumentation data
+	/// \param value Value to add
+	static void add_count(const char* name, long long value);
+
+	/// Get whether the library was built with instrumentation
+	///
+	/// \return Whether scopes and counters are recorded
+	static bool is_enabled();
+	/// Get the totals of all scopes and counters recorded so far
+	///
+	/// \param stats Vector the totals are appended to
+	static void get_stats(std::vector<Fle_Instrumentation_Stats>& stats);
+	/// Get the totals of a scope or counter
+	///
+	/// \param name Name of the scope or counter
+	/// \param stats Set to the totals
+	/// \return Whether anything was recorded under the name
+	static bool get_stats(const char* name, Fle_Instrumentation_Stats& stats);
+	/// Get the number of trace events dropped because the event buffer was full
+	///
+	/// \return Dropped event count
+	static long long get_dropped_events();
+	/// Clear all totals and trace events
+	static void reset();
+	/// Write the recorded trace events as Chrome trace event JSON
+	///
+	/// \param path Path of the file to write
+	/// \return Whether the file could be written
+	static bool write_chrome_trace(const char* path);
+};
+
+#ifdef FLE_INSTRUMENTATION
+#define FLE_INSTRUMENT_CONCAT2(a, b) a##b
+#define FLE_INSTRUMENT_CONCAT(a, b) FLE_INSTRUMENT_CONCAT2(a, b)
+/// Times the rest of the enclosing block under a name
+#define FLE_INSTRUMENT_SCOPE(name) Fle_Instrumentation::Scope FLE_INSTRUMENT_CONCAT(fle_instrument_scope_, __LINE__)(name)
+/// Adds a value to a named counter
+#define FLE_INSTRUMENT_COUNT(name, value) Fle_Instrumentation::add_count(name, value)
+#else
+#define FLE_INSTRUMENT_SCOPE(name) ((void)0)
+// The value is not evaluated, but counts as used
+#define FLE_INSTRUMENT_COUNT(name, value) ((void)sizeof(value))
+#endif
+
+#endif
@@ -2,12 +2,54 @@
 #define FLE_LISTVIEW_H
 
 #include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <atomic>
+#include <functional>
 
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Scrollbar.H>
+#include <FL/platform_types.h>
 
 #include <FLE/Fle_Listview_Item.hpp>
 
+class Fl_RGB_Image;
+class Fle_Icon_Loader;
+class Fle_Label_Editor;
+class Fle_Listview_Exporter;
+class Fle_Row_Index;
+
+/** \class Fle_Listview_Icon_Provider
+	\brief Supplies item icons to a listview asynchronously.
+
+	Subclass it and pass it to Fle_Listview::set_icon_provider(). The listview
+	requests icons only for the visible and near-visible items, and shows the
+	item's own icon until the requested one is ready. Requests for items that
+	have been scrolled far out of view are cancelled before they are started.
+
+	load_icon() is called on a worker thread. It must not use any FLTK drawing
+	functions or access the listview or it's items. The finished images are
+	passed back to the listview on the FLTK thread with Fl::awake(), so the
+	application must call Fl::lock() once before Fl::run().
+**/
+class Fle_Listview_Icon_Provider
+{
+public:
+	virtual ~Fle_Listview_Icon_Provider() {}
+
+	/// Load an icon. Called on a worker thread.
+	///
+	/// \param key Icon key of the item, see Fle_Listview_Item::set_icon_key()
+	/// \param size Size of the requested icon, 16 or 32
+	/// \return New image, owned by the item from now on, or nullptr
+	virtual Fl_RGB_Image* load_icon(const std::string& key, int size) = 0;
+};
+
+/// Called when a tree-list item is expanded for the first time. The callback
+/// adds the children of the item with Fle_Listview::add_child_item().
+typedef void (Fle_Listview_Children_Callback)(Fle_Listview*, Fle_Listview_Item*, void*);
+
 /// \enum Fle_Listview_Flags
 /// Listview state flags
 enum Fle_Listview_Flags
@@ -24,6 +66,11 @@ enum Fle_Listview_Flags
 	FLE_LISTVIEW_DND = 1 << 9, ///< Whether the listview allows drag and drop
 	FLE_LISTVIEW_INDICES_INVALIDATED = 1 << 10, ///< Stored indices may be invalidated during CB
 	FLE_LISTVIEW_ITEM_TOOLTIPS = 1 << 11, ///< Does the listview show item tooltips?
+	FLE_LISTVIEW_SMOOTH_SCROLLING = 1 << 12, ///< Ease mouse wheel scrolling over several frames
+	FLE_LISTVIEW_KINETIC_SCROLLING = 1 << 13, ///< Keep scrolling with decaying speed after the wheel stops
+	FLE_LISTVIEW_GROUPED_ROWS = 1 << 14, ///< Whether items are grouped by their group key
+	FLE_LISTVIEW_NEEDS_GROUPING = 1 << 15, ///< Whether the groups need to be rebuilt
+	FLE_LISTVIEW_TREE_LIST = 1 << 16, ///< Whether items are shown as a tree in details mode
 };
 
 /// \enum Fle_Listview_Reason
@@ -37,9 +84,42 @@ enum Fle_Listview_Reason
 	FLE_LISTVIEW_REASON_ADDED = FL_REASON_OPENED, ///< Item has been added
 	FLE_LISTVIEW_REASON_REMOVED = FL_REASON_CLOSED, ///< Item has been removed
 	FLE_LISTVIEW_REASON_DND_END = FL_REASON_DRAGGED, ///< DND operation has ended
+	FLE_LISTVIEW_REASON_RENAMED = FL_REASON_CHANGED, ///< Item has been renamed by the user
 	FLE_LISTVIEW_REASON_DND_START = FL_REASON_USER ///< DND operation has started
 };
 
+/// \enum Fle_Listview_Export_Format
+/// Listview export formats
+enum Fle_Listview_Export_Format
+{
+	FLE_LISTVIEW_EXPORT_CSV, ///< Comma-separated values with a header line, quoted where needed
+	FLE_LISTVIEW_EXPORT_TSV, ///< Tab-separated values with a header line, tabs and line breaks replaced by spaces
+	FLE_LISTVIEW_EXPORT_JSONL, ///< One JSON object per line, keyed by the column headers
+};
+
+/// \enum Fle_Listview_Export_Rows
+/// Rows written by an export
+enum Fle_Listview_Export_Rows
+{
+	FLE_LISTVIEW_EXPORT_ALL, ///< All items
+	FLE_LISTVIEW_EXPORT_SELECTED, ///< Selected items
+	FLE_LISTVIEW_EXPORT_SHOWN, ///< Items not hidden in collapsed groups
+};
+
+/// \enum Fle_Listview_Export_Status
+/// State of an export reported to the export callback
+enum Fle_Listview_Export_Status
+{
+	FLE_LISTVIEW_EXPORT_RUNNING, ///< Rows are being written
+	FLE_LISTVIEW_EXPORT_FINISHED, ///< All rows have been written and the file is closed
+	FLE_LISTVIEW_EXPORT_FAILED, ///< Writing the file failed
+	FLE_LISTVIEW_EXPORT_CANCELLED, ///< The export was cancelled, or items were removed during it
+};
+
+/// Reports the progress of an export: the status, the rows formatted so far
+/// and the number of rows exported.
+typedef void (Fle_Listview_Export_Callback)(Fle_Listview*, Fle_Listview_Export_Status, int, int, void*);
+
 /** \class Fle_Listview
 	\brief 
 	Listview class is used to display a list of items. It is somewhat similar
@@ -61,6 +141,9 @@ enum Fle_Listview_Reason
 	- Items can be selected both in single and in multiple selection mode
 	- Selected items can be removed with remove_selected()
 	- Drag and drop can be enabled/disabled with dnd()
+	- Items can be grouped by their group key with grouped_rows()
+	- Items can be shown as an expandable tree in details mode with tree_list()
+	- Items can be exported to CSV, TSV or JSON Lines with export_items()
 
 	\par Details mode:
 	
@@ -102,10 +185,18 @@ enum Fle_Listview_Reason
 
 	Drag and drop is optional, and it is enabled by default.
 	To disable drag and drop, call dnd(false). DND operations require the use
-	of callbacks. DND operations rely on the concept of 'drag zones', which are
-	rectangles inside individual item rectangles that typically span just the
-	icon and the text, but not the empty space around the item. This is done so
-	that both dragNdrop and box selection is possible.
+	of callbacks, unless a payload format is set with set_dnd_format(), in
+	which case the listview fills the payload itself, reusing it's buffer from
+	one drag to the next. Items with relative names are left out of URI list
+	payloads, unless Fle_Listview_Item::append_dnd_data() is overridden.
+	Within the application, the listview the items are dragged from is
+	returned by get_dnd_source() when they are dropped, so the drop target can
+	use it's selected items directly.
+
+	DND operations rely on the concept of 'drag zones', which are rectangles
+	inside individual item rectangles that typically span just the icon and
+	the text, but not the empty space around the item. This is done so that
+	both dragNdrop and box selection is possible.
 
 	Typical callback for DND:
 	\code
@@ -147,6 +238,50 @@ enum Fle_Listview_Reason
  **/
 class Fle_Listview : public Fl_Group
 {
+	friend class Fle_Listview_Item;
+
+	/// Pointer interaction state of a single listview
+	struct Interaction
+	{
+		int dragX; //< X coordinate the drag started at
+		int dragY; //< Y coordinate the drag started at
+		int resizingHeaderProperty; //< Property whose header is being resized, -2 if none
+		int resizeStartWidth; //< Width of the resized property when the resize began
+		int resizeWidth; //< Width the resized property gets on release
+		int lastGridX; //< Grid X coordinate of the last box selection update
+		int lastGridY; //< Grid Y coordinate of the last box selection update
+		bool itemDrag; //< Whether selected items are being dragged
+		Fle_Listview_Item* hitItem; //< Result of the last hit test
+		Fle_Listview_Item* tooltipItem; //< Item the tooltip was last set for
+		int hitX; //< X coordinate of the last hit test
+		int hitY; //< Y coordinate of the last hit test
+		int hitScrollX; //< Horizontal scroll position during the last hit test
+		int hitScrollY; //< Vertical scroll position during the last hit test
+		bool hitValid; //< Whether the last hit test result can be reused
+		int headerDragIndex; //< Property order index of the header being dragged, -1 if none
+		int headerDragGrabX; //< Pointer position relative to the dragged header
+		int headerDragX; //< Current pointer X coordinate of the header drag
+		int headerDragLeft; //< X coordinate the columns started at when the drag began
+		int headerDragFirst; //< First property order index visible when the drag began
+		int headerDragLast; //< Last property order index visible when the drag began
+		bool headerDragging; //< Whether a header is being dragged past the threshold
+
+		Interaction();
+		/// Forgets any interaction in progress
+		void reset();
+		/// Drops all references to an item that is being removed
+		void forget_item(Fle_Listview_Item* item);
+	};
+
+	/// Items sharing a group key, kept next to each other in the item vector
+	struct Group
+	{
+		std::string key; //< Group key of the items
+		int first; //< Index of the first item of the group
+		int count; //< Number of items in the group
+		bool collapsed; //< Whether the rows of the items are hidden
+	};
+
 	Fle_Listview_Display_Mode m_displayMode;
 
 	int m_state; //< Internal state of the listview
@@ -159,8 +294,24 @@ class Fle_Listview : public Fl_Group
 	int m_itemsBBoxX; //< X coordinate of the items bounding box
 	int m_itemsBBoxY; //< Y coordinate of the items bounding box
 	int m_columnWidth; //< Width of a single column of items
+	int m_gridCellW; //< Width of a single grid cell, set by arrange_items()
+	int m_gridCellH; //< Height of a single grid cell, set by arrange_items()
+	int m_gridPerLine; //< Items in a grid row, or a grid column in list mode
+	int m_gridOriginY; //< Y coordinate of the first grid row
+	int m_anchorIndex; //< Index of the item the viewport is anchored to
+	int m_anchorOffset; //< Position of the anchor item relative to the scroll position
+	bool m_anchorSaved; //< Whether the anchor is waiting to be restored by arrange_items()
+	bool m_anchorHorizontal; //< Whether the anchor offset is horizontal
+	int m_iconRangeFirst; //< First item of the range icons were last requested for
+	int m_iconRangeLast; //< Last item of the range icons were last requested for
 
 	Fle_Listview_Item* m_callbackItem; //< Item involved in a callback
+	Fle_Icon_Loader* m_iconLoader; //< Worker pool running the icon provider
+	Fle_Listview_Exporter* m_exporter; //< Export in progress, nullptr if none
+	Fle_Listview_Dnd_Format m_dndFormat; //< Format of the payload built when a drag starts
+	std::string m_dndPayload; //< Drag and drop payload, kept to reuse it's capacity
+	Fle_Listview_Item* m_anchorItem; //< Item the viewport is anchored to, if it's still present
+	Interaction m_interaction; //< Pointer interaction state
 
 	std::vector<Fle_Listview_Item*> m_items; //< Vector of items
 	std::vector<int> m_selected; //< Vector of selected indices
@@ -168,6 +319,45 @@ class Fle_Listview : public Fl_Group
 	std::vector<int> m_propertyOrder; //< Vector of property order
 	std::vector<int> m_propertyHeaderWidths; //< Vector of property header widths
 	std::vector<int> m_propertyHeaderMinWidths; //< Vector of property header minimum widths
+	std::vector<Group> m_groups; //< Groups in display order, valid unless regrouping is pending
+	std::vector<int> m_groupOffsets; //< Offset of each group header from the first row in details mode, followed by the height of all rows
+	Fle_Row_Index* m_rowIndex; //< Prefix sums of the row heights in details mode
+	int m_layoutGeneration; //< Changed when row heights move rows that aren't placed again right away
+	std::vector<int> m_columnEdges; //< Right edges of the property columns in details mode, in property order, followed by the name column's
+	std::map<Fl_Pixmap*, Fl_RGB_Image*> m_iconCache; //< Pre-rasterised copies of item icons
+
+	std::atomic<Fle_Listview_Item*> m_postedItems; //< Lock-free stack of items posted by other threads
+	std::atomic<bool> m_postScheduled; //< Whether posted items are going to be drained
+	std::deque<Fle_Listview_Item*> m_postBacklog; //< Posted items waiting to be added, in order
+	int m_postBatchSize; //< Maximal number of posted items added per frame
+
+	double m_scrollPending; //< Wheel scrolling not applied yet, in pixels
+	double m_scrollVelocity; //< Kinetic scrolling speed, in pixels per frame
+	int m_scrollFrameRate; //< Maximal number of scroll steps per second
+	int m_keyFocusPending; //< Item keyboard navigation moves the focus to next frame, -1 if none
+	bool m_keyExtendPending; //< Whether the pending focus move extends the selection
+	int m_pinnedColumns; //< Leading columns kept in view in details mode
+	Fl_Offscreen m_pinnedStrip; //< Pinned columns of the visible rows, drawn unscrolled
+	int m_pinnedStripW; //< Width of the pinned strip
+	int m_pinnedStripH; //< Height of the pinned strip
+	int m_pinnedStripScrollY; //< Vertical scroll position the pinned strip was drawn at
+	bool m_pinnedStripValid; //< Whether the pinned strip can be copied as it is
+	bool m_drawingPinned; //< Whether items are being drawn into the pinned strip
+	int m_itemDrawOffsetX; //< Added to item X coordinates while drawing into an offscreen
+	int m_itemDrawOffsetY; //< Added to item Y coordinates while drawing into an offscreen
+	Fl_Offscreen m_headerCache; //< Header band as it was last drawn
+	std::vector<int> m_headerCacheKey; //< Header layout and colors the cached header was drawn with
+	std::string m_headerCacheScheme; //< FLTK and Fleet schemes the cached header was drawn with
+	Fl_RGB_Image* m_headerDragSnapshot; //< Listview as it looked when a header drag or resize began
+	std::multiset<int> m_labelWidths; //< Label widths of all items, while m_labelWidthsValid
+	bool m_labelWidthsValid; //< Whether label widths are kept up to date as items come and go
+	Fl_Font m_labelWidthsFont; //< Font the label widths were measured with
+	Fl_Fontsize m_labelWidthsSize; //< Font size the label widths were measured with
+	Fle_Listview_Children_Callback* m_childrenCallback; //< Adds the children of an item expanded for the first time
+	void* m_childrenCallbackData; //< User data passed to the children callback
+	Fle_Label_Editor* m_labelEditor; //< Input reused for in-place label editing
+	Fle_Listview_Item* m_editedItem; //< Item whose label is being edited
+	int m_editedIndex; //< Index of the edited item when the edit began
 
 	Fl_Color m_headersColor; //< Color of the header section
 
@@ -179,6 +369,182 @@ class Fle_Listview : public Fl_Group
 	void do_callback_for_item(Fle_Listview_Item* item, Fle_Listview_Reason reason);
 	/// Internal redraw function
 	void listview_redraw();
+	/// Requests provider icons for the visible and near-visible items
+	void request_visible_icons();
+	/// Remembers the focused or top visible item and it's offset in the viewport,
+	/// before the layout changes
+	void save_anchor();
+	/// Scrolls the anchor item back to it's saved offset after a relayout
+	void restore_anchor();
+	/// Appends an item without invalidating stored indices
+	void append_item(Fle_Listview_Item* item);
+	/// Adds a batch of posted items
+	void drain_posted_items();
+	/// Fl::awake callback scheduling the draining of posted items
+	static void post_awake_cb(void* data);
+	/// Timeout callback draining posted items once per frame
+	static void post_timeout_cb(void* data);
+	/// Frame scheduler callback requesting the redraw scheduled by listview_redraw()
+	static void frame_cb(void* data, int work);
+	/// Timeout callback formatting a slice of the exported rows once per frame
+	static void export_timeout_cb(void* data);
+	/// Formats a slice of the exported rows and reports the progress
+	void export_step();
+	/// Serialises the selected items into the drag and drop payload and copies it for Fl::dnd()
+	void copy_dnd_payload();
+	/// Returns the item at given coordinates, reusing the last result
+	/// if neither the coordinates nor the layout have changed since
+	Fle_Listview_Item* hit_test(int X, int Y);
+	/// Draws the header band
+	void draw_header(int X, int Y);
+	/// Draws the header band with other column edges, to preview a resize
+	void draw_header(int X, int Y, const std::vector<int>& edges, int nameWidth);
+	/// Copies the header band from the cache, drawing it again only if it's
+	/// layout, sort state, scheme or colors changed since it was cached
+	void draw_cached_header();
+	/// Forces the header band to be drawn again
+	void invalidate_header_cache();
+	/// Captures the listview for a header drag
+	void begin_header_drag();
+	/// Position among the other visible columns the dragged header would be released at
+	int get_header_drag_target() const;
+	/// Draws the columns of the captured listview in the order they would
+	/// have after the header drag, and the dragged header floating above
+	void draw_header_drag();
+	/// Draws the captured listview with a preview of the resized header and
+	/// a guide line at the new column edge
+	void draw_header_resize();
+	/// Moves the label editor over the edited item's text
+	void place_label_editor();
+	/// Whether an item goes before another one in the current sort order
+	bool is_sorted_before(Fle_Listview_Item* a, Fle_Listview_Item* b) const;
+	/// Index an item needs to be moved to for the list to stay sorted
+	int get_sorted_position(int index) const;
+	/// Moves an item to another index, keeping selection and focus on the same items
+	void move_item(int from, int to);
+	/// Sorts a range of items and merges it back into the other items, which are still sorted
+	void merge_sorted_range(int first, int last);
+	/// Redraws only the rows of the given items that are in view
+	void damage_items(int first, int last);
+	/// Positions items in their grid cells without arranging the others
+	void place_items(int first, int last);
+	/// Get the width of an item's label, measuring it only if it wasn't measured yet
+	int get_cached_label_width(Fle_Listview_Item* item);
+	/// Adds an item's label width to the widths the list column width is taken from
+	void track_label_width(Fle_Listview_Item* item);
+	/// Removes an item's label width from the widths the list column width is taken from
+	void untrack_label_width(Fle_Listview_Item* item);
+	/// Inserts rows into the item vector, moving the stored indices after them
+	void insert_rows(int index, const std::vector<Fle_Listview_Item*>& rows);
+	/// Removes rows from the item vector without deleting them, deselecting them
+	void remove_rows(int first, int count);
+	/// Appends an item and it's expanded descendants to a list of rows
+	void append_tree_rows(std::vector<Fle_Listview_Item*>& rows, Fle_Listview_Item* item) const;
+	/// Sorts the children of an item and all of it's descendants
+	void sort_subtree(Fle_Listview_Item* item, const std::function<bool(Fle_Listview_Item*, Fle_Listview_Item*)>& order);
+	/// Rebuilds the groups in one pass over the items, keeping their order within a group.
+	/// This reorders m_items. The stored indices are moved along with their items
+	/// instead of setting FLE_LISTVIEW_INDICES_INVALIDATED, so the selection is kept.
+	void build_groups();
+	/// Recalculates the offset of every group header from the heights of the rows before it
+	void update_group_offsets();
+	/// Whether group headers are shown and collapsed groups hidden
+	bool rows_grouped() const;
+	/// Binary search for the group an item belongs to
+	///
+	/// \param index Item index
+	/// \return Group index
+	int find_item_group(int index) const;
+	/// Get the group whose header or items are at an offset from the first row
+	///
+	/// \param offset Y offset from the first row
+	/// \return Group index
+	int get_offset_group(int offset) const;
+	/// Get the item whose row is at an offset from the first row in details mode
+	///
+	/// \param offset Y offset from the first row
+	/// \return Item index, -1 for a group header or past the last row
+	int get_item_at_offset(int offset) const;
+	/// Get the offset of an item's row from the first row in details mode
+	///
+	/// \param index Item index
+	/// \return Y offset
+	int get_item_offset(int index) const;
+	/// Get the height of all rows in details mode, including group headers
+	int get_rows_height() const;
+	/// Places an item in it's details row
+	void place_row(int index) const;
+	/// Places an item again if row height changes moved it since it was placed
+	void update_item_position(int index) const;
+	/// Places an item again if row height changes moved it since it was placed
+	void update_item_position(Fle_Listview_Item* item) const;
+	/// Get the group whose header is under the given coordinates
+	///
+	/// \return Group index, -1 if there is no header
+	int get_group_header_at(int X, int Y) const;
+	/// Get the first item from an index on, in the given direction, not hidden by a collapsed group
+	///
+	/// \param index Item index
+	/// \param direction 1 to look forward, -1 to look backward
+	/// \return Item index, out of range if every item in the direction is hidden
+	int next_shown_item(int index, int direction) const;
+	/// Draws the group headers of the visible rows
+	void draw_group_headers();
+	/// Renames an item, keeping the list sorted
+	void rename_item(int index, const std::string& name);
+	/// Applies the column order of a finished header drag
+	void end_header_drag();
+	/// Draws a range of header columns, and optionally the name header
+	///
+	/// \param X X coordinate of the header band
+	/// \param Y Y coordinate of the header band
+	/// \param left X coordinate the columns start at
+	/// \param first First index into the property order
+	/// \param last Last index into the property order
+	/// \param name Whether to draw the name header
+	/// \param edges Column edges, as m_columnEdges
+	/// \param nameWidth Width of the name column
+	void draw_header_columns(int X, int Y, int left, int first, int last, bool name, const std::vector<int>& edges, int nameWidth);
+	/// Draws the pinned columns of the visible rows, from the strip cached
+	/// during the last draw if only horizontal scrolling happened since
+	void draw_pinned_strip(int first, int last);
+	/// Width of the pinned columns, including the left margin, 0 if none are pinned
+	int get_pinned_width() const;
+	/// Width of the pinned columns with given column edges
+	int get_pinned_width(const std::vector<int>& edges) const;
+	/// Range of the visible property columns with given column edges
+	void get_visible_properties(const std::vector<int>& edges, int& first, int& last) const;
+	/// Lays out the details columns right to left from the header widths
+	///
+	/// \param property Property laid out with another width, -2 for none
+	/// \param width Width of that property
+	/// \param edges Set to the column edges, as m_columnEdges
+	/// \return Width of the name column
+	int layout_columns(int property, int width, std::vector<int>& edges) const;
+	/// Get the property whose header is under an X coordinate in details mode
+	///
+	/// \param X X coordinate
+	/// \param edge Whether to look for the resize handle on the left edge of a header instead
+	/// \return Property, -1 for the name header, -2 if none
+	int get_header_property_at(int X, bool edge) const;
+	/// Timeout callback updating the item tooltip once the pointer rests
+	static void tooltip_timeout_cb(void* data);
+	/// Timeout callback applying merged keyboard focus moves once per frame
+	static void key_timeout_cb(void* data);
+	/// Moves the focus to the item keyboard navigation has last targeted
+	void apply_keyboard_focus();
+	/// Selects exactly the items between two indices, inclusive
+	void select_range(int from, int to);
+	/// Timeout callback applying merged wheel scrolling once per frame
+	static void scroll_timeout_cb(void* data);
+	/// Applies one frame of wheel scrolling
+	void scroll_frame();
+	/// Stops wheel scrolling that hasn't been applied yet
+	void stop_scroll_animation();
+	/// Scrolls in the wheel direction of the current display mode
+	///
+	/// \return False if the scroll position didn't change
+	bool scroll_by(int pixels);
 
 protected:
 
@@ -188,6 +554,12 @@ protected:
 	virtual void keyboard_select(int key);
 	/// Internal function to get grid coordinates at x, y
 	virtual void get_grid_xy_at(int x, int y, int& gridX, int& gridY);
+	/// Get the range of item indices that intersect the viewport
+	/// 
+	/// \param first First item index
+	/// \param last Last item index, less than first if no item is visible
+	/// \param extraLines Number of grid lines to extend the range by on each side
+	virtual void get_visible_range(int& first, int& last, int extraLines = 0) const;
 	/// Set item focused
 	void set_focused(int item);
 	/// Set item focus status
@@ -225,6 +597,37 @@ public:
 	///
 	/// \param item Pointer to the item
 	void insert_item(Fle_Listview_Item* item, int index);
+	/// Updates an item after it's name, colors, icon, group or properties
+	/// have been changed. Only the item's label is measured again, it keeps
+	/// it's place in a sorted list, and only it's row is redrawn unless the
+	/// layout changes.
+	///
+	/// \param index Index of the item
+	void update_item(int index);
+	/// Updates a range of items after they have been changed, see update_item()
+	///
+	/// \param first Index of the first item
+	/// \param last Index of the last item
+	void update_items(int first, int last);
+	/// Adds an item from any thread.
+	/// This is the only listview method that may be called outside the
+	/// FLTK thread. The items are queued without locking, and added on the
+	/// FLTK thread in batches of at most get_post_batch_size() items per frame,
+	/// with a single relayout and redraw per batch. The listview takes
+	/// ownership of posted items that haven't been added yet when it's
+	/// destroyed, so all producers must stop before that. Fl::lock() must have
+	/// been called once before Fl::run(), as required by Fl::awake().
+	///
+	/// \param item Pointer to the item
+	void post_item(Fle_Listview_Item* item);
+	/// Set the maximal number of posted items added per frame
+	///
+	/// \param items Batch size
+	void set_post_batch_size(int items);
+	/// Get the maximal number of posted items added per frame
+	///
+	/// \return Batch size
+	int get_post_batch_size() const;
 	/// Removes an item
 	/// This does not delete the item.
 	/// 
@@ -241,6 +644,26 @@ public:
 	/// Removes all items
 	/// This does delete all items.
 	void clear_items();
+	/// Export items to a file, in the current sort and column order: the name
+	/// column first, followed by the properties as they are shown in details
+	/// mode, with get_property_text() of each item. The rows are formatted on
+	/// the FLTK thread a few milliseconds per frame and written by a worker
+	/// thread through a small set of reused buffers, so the whole output is
+	/// never held in memory. Removing items cancels the export.
+	///
+	/// \param path Path of the file, which is overwritten
+	/// \param format File format
+	/// \param rows Rows to export
+	/// \param cb Callback reporting the progress, or nullptr
+	/// \param data User data passed to the callback
+	/// \return Whether the file could be created; any export in progress is cancelled
+	bool export_items(const char* path, Fle_Listview_Export_Format format, Fle_Listview_Export_Rows rows, Fle_Listview_Export_Callback* cb = nullptr, void* data = nullptr);
+	/// Cancel the export in progress, leaving the part of the file written so far
+	void cancel_export();
+	/// Get whether an export is in progress
+	///
+	/// \return Whether an export is in progress
+	bool is_exporting() const;
 
 	/// Returns the number of items
 	///
@@ -281,6 +704,10 @@ public:
 	///
 	/// \return Vector of selected item indices
 	const std::vector<int>& get_selected() const;
+	/// Get the selected items as ranges of consecutive indices, in index order
+	///
+	/// \param ranges Filled with the first and last index of each range
+	void get_selected_ranges(std::vector<std::pair<int, int>>& ranges) const;
 
 	/// Sets the display mode
 	///
@@ -334,6 +761,22 @@ public:
 	///
 	/// \return Drag and drop enabled
 	bool dnd() const { return m_state & FLE_LISTVIEW_DND; }
+	/// Set the format of the payload the listview builds from the selected
+	/// items when a drag starts. The application may still replace it with
+	/// Fl::copy() on FLE_LISTVIEW_REASON_DND_START.
+	///
+	/// \param format Payload format, FLE_LISTVIEW_DND_NONE to leave it to the application
+	void set_dnd_format(Fle_Listview_Dnd_Format format);
+	/// Get the format of the payload built when a drag starts
+	///
+	/// \return Payload format
+	Fle_Listview_Dnd_Format get_dnd_format() const;
+	/// Get the listview items are being dragged from, within the application.
+	/// On FLE_LISTVIEW_REASON_DND_END, the dropped items are the selected items
+	/// of this listview, see get_selected_ranges().
+	///
+	/// \return Listview the drag started in, nullptr for drops from other applications
+	static Fle_Listview* get_dnd_source();
 
 	/// Set item tooltips flag
 	/// When it's set to true, individual items will have tooltips
@@ -345,6 +788,61 @@ public:
 	/// \return Item tooltips
 	bool item_tooltips() const { return m_state & FLE_LISTVIEW_ITEM_TOOLTIPS; }
 
+	/// Set whether item labels can be edited by the user. The focused item
+	/// is renamed in place after pressing F2, Enter commits the new name and
+	/// Escape cancels. Renamed items are moved to keep a sorted list sorted.
+	///
+	/// \param edit Label editing enabled
+	void edit_labels(bool edit);
+	/// Get whether item labels can be edited by the user
+	///
+	/// \return Label editing enabled
+	bool edit_labels() const { return m_state & FLE_LISTVIEW_EDIT_LABELS; }
+	/// Start editing the label of an item
+	///
+	/// \param index Index of the item
+	void edit_item_label(int index);
+	/// Finish editing the label of an item, if any is being edited
+	///
+	/// \param commit Whether to rename the item or discard the edit
+	void end_label_edit(bool commit);
+	/// Get the item whose label is being edited
+	///
+	/// \return Edited item, or nullptr
+	Fle_Listview_Item* get_edited_item() const;
+
+	/// Set smooth scrolling
+	/// Wheel events are always merged and applied at most once per frame.
+	/// With smooth scrolling, the merged distance is eased over several frames.
+	///
+	/// \param smooth Smooth scrolling enabled
+	void smooth_scrolling(bool smooth);
+	/// Get smooth scrolling
+	///
+	/// \return Smooth scrolling enabled
+	bool smooth_scrolling() const { return m_state & FLE_LISTVIEW_SMOOTH_SCROLLING; }
+
+	/// Set kinetic scrolling
+	/// When it's set to true, scrolling continues with decaying speed
+	/// after the wheel stops.
+	///
+	/// \param kinetic Kinetic scrolling enabled
+	void kinetic_scrolling(bool kinetic);
+	/// Get kinetic scrolling
+	///
+	/// \return Kinetic scrolling enabled
+	bool kinetic_scrolling() const { return m_state & FLE_LISTVIEW_KINETIC_SCROLLING; }
+
+	/// Set the maximal number of wheel scroll steps per second.
+	/// Set it to the display refresh rate.
+	///
+	/// \param fps Frame rate
+	void set_scroll_frame_rate(int fps);
+	/// Get the maximal number of wheel scroll steps per second
+	///
+	/// \return Frame rate
+	int get_scroll_frame_rate() const;
+
 	/// Add property
 	///
 	/// \param name Name of the property
@@ -370,6 +868,29 @@ public:
 	/// \param property Property index
 	/// \return Property width
 	int  get_property_header_width(int property) const;
+	/// Get the range of property order indices whose columns intersect the
+	/// viewport in details mode. Found by binary search over the column edges.
+	/// While the pinned columns are drawn, this is the pinned range instead.
+	///
+	/// \param first First index into get_property_order()
+	/// \param last Last index into get_property_order(), less than first if no column is visible
+	void get_visible_properties(int& first, int& last) const;
+	/// Get the X offset of a property column from the left edge of the items
+	///
+	/// \param index Index into get_property_order()
+	/// \return Column offset
+	int  get_property_x(int index) const;
+	/// Set the number of leading details mode columns that stay in view when
+	/// the rest are scrolled horizontally. 1 pins the name column, 2 also the
+	/// property right of it, and so on. Pinned columns are cached offscreen,
+	/// so horizontal scrolling only redraws the scrolled columns.
+	///
+	/// \param columns Number of pinned columns, 0 for none
+	void set_pinned_columns(int columns);
+	/// Get the number of pinned columns
+	///
+	/// \return Number of pinned columns
+	int  get_pinned_columns() const;
 	/// Set margin
 	///
 	/// \param m Margin
@@ -383,6 +904,29 @@ public:
 	/// \return Item column width
 	int  get_item_column_width() const;
 
+	/// Get the pre-rasterised copy of an item icon.
+	/// Every distinct pixmap is converted to a RGBA image once, on first use,
+	/// so drawing items doesn't need to decode the pixmap and it's mask again.
+	///
+	/// \param icon Pixmap used as an item icon
+	/// \return Cached image, or the pixmap itself if it can't be converted
+	Fl_Image* get_cached_icon(Fl_Pixmap* icon);
+	/// Clear the icon cache.
+	/// Must be called after a pixmap used as an item icon is modified or deleted.
+	void clear_icon_cache();
+	/// Set the asynchronous icon provider.
+	/// The provider is not owned by the listview, and must outlive it or be
+	/// unset with set_icon_provider(nullptr). Icons supplied by a previous
+	/// provider are discarded.
+	///
+	/// \param provider Icon provider, or nullptr
+	/// \param threads Number of worker threads
+	void set_icon_provider(Fle_Listview_Icon_Provider* provider, int threads = 2);
+	/// Get the asynchronous icon provider
+	///
+	/// \return Icon provider
+	Fle_Listview_Icon_Provider* get_icon_provider() const;
+
 	/// Set name display text
 	///
 	/// \param t Text
@@ -402,6 +946,92 @@ public:
 	/// \return Sorted by property
 	int get_sorted_by_property() const;
 
+	/// Set whether items are grouped by their group key. Groups are ordered by
+	/// their key and keep the order of their items. In details mode, every group
+	/// is shown under a header that collapses or expands it when clicked.
+	/// Grouping moves items, so item indices change whenever the groups are
+	/// rebuilt, after items are added or removed or regroup_items() is called.
+	/// The selection and the focused item follow their items.
+	///
+	/// \param grouped Grouped rows
+	void grouped_rows(bool grouped);
+	/// Get whether items are grouped by their group key
+	///
+	/// \return Grouped rows
+	bool grouped_rows() const { return m_state & FLE_LISTVIEW_GROUPED_ROWS; }
+	/// Rebuild the groups after group keys of items in the listview have changed
+	void regroup_items();
+	/// Get the number of groups
+	///
+	/// \return Number of groups, 0 if items aren't grouped
+	int get_group_count();
+	/// Get the key of a group
+	///
+	/// \param group Group index
+	/// \return Group key
+	const std::string& get_group_key(int group);
+	/// Get the range of items in a group
+	///
+	/// \param group Group index
+	/// \param first Index of the first item
+	/// \param count Number of items
+	void get_group_items(int group, int& first, int& count);
+	/// Get the group of an item
+	///
+	/// \param index Item index
+	/// \return Group index, -1 if items aren't grouped
+	int get_item_group(int index);
+	/// Collapse or expand a group, hiding or showing it's rows in details mode
+	///
+	/// \param group Group index
+	/// \param collapsed Whether the group is collapsed
+	void set_group_collapsed(int group, bool collapsed);
+	/// Get whether a group is collapsed
+	///
+	/// \param group Group index
+	/// \return Whether the group is collapsed
+	bool is_group_collapsed(int group);
+
+	/// Set whether items are shown as a tree in details mode. The item vector
+	/// holds only the visible rows: root items and the descendants of expanded
+	/// items. Children are added with add_child_item(), possibly from the
+	/// children callback when their parent is expanded for the first time.
+	/// A tree-list doesn't group rows.
+	///
+	/// \param tree Tree-list mode
+	void tree_list(bool tree);
+	/// Get whether items are shown as a tree in details mode
+	///
+	/// \return Tree-list mode
+	bool tree_list() const { return m_state & FLE_LISTVIEW_TREE_LIST; }
+	/// Set the callback adding the children of items expanded for the first time
+	///
+	/// \param cb Callback, or nullptr
+	/// \param data User data passed to the callback
+	void set_children_callback(Fle_Listview_Children_Callback* cb, void* data = nullptr);
+	/// Add a child item. The parent takes ownership of it.
+	///
+	/// \param parent Parent item, or nullptr to add a root item
+	/// \param child New item
+	void add_child_item(Fle_Listview_Item* parent, Fle_Listview_Item* child);
+	/// Expand or collapse an item in tree-list mode
+	///
+	/// \param index Index of the item
+	/// \param expand Whether to show the children
+	void expand_item(int index, bool expand);
+
+	/// Set the height of an item's row in details mode. Only the changed row is
+	/// placed again right away, the rows after it when they are needed.
+	///
+	/// \param index Item index
+	/// \param height Row height
+	void set_row_height(int index, int height);
+	/// Get the height of an item's row in details mode
+	///
+	/// \param index Item index
+	/// \return Row height
+	int get_row_height(int index) const;
+
 	/// Allow/disallow redraw
 	///
 	/// \param redraw Allow redraw
@@ -0,0 +1,133 @@
+#ifndef FLE_LISTVIEW_CSV_SOURCE_H
+#define FLE_LISTVIEW_CSV_SOURCE_H
+
+#include <FLE/Fle_Listview.hpp>
+#include <FLE/Fle_Listview_Item.hpp>
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+
+class Fle_Csv_Mapping;
+
+/** \class Fle_Listview_Csv_Item
+	\brief Listview item showing one row of a memory-mapped CSV or TSV file.
+
+	The item keeps only the position of it's row in the mapped file. The first
+	cell is copied as the item name; the other cells are read from the mapping
+	whenever they are drawn or compared, and are shown as the properties of the
+	item in details mode. The item keeps the mapping alive, so the source may
+	be closed while it's items are still in the listview.
+**/
+class Fle_Listview_Csv_Item : public Fle_Listview_Item
+{
+	std::shared_ptr<const Fle_Csv_Mapping> m_mapping; ///< File the row is in
+	size_t m_begin; ///< Offset of the first byte of the row
+	size_t m_end; ///< Offset past the last byte of the row, without the line break
+
+protected:
+	/// Compares the cells of a property, numerically if both are numbers
+	bool is_greater(Fle_Listview_Item* other, int property) override;
+	/// Draws the cell of a property straight from the mapping
+	void draw_property(int property, int X, int Y, int W, int H) override;
+
+public:
+	/// Constructs an item for a row of a mapped file
+	///
+	/// \param mapping File the row is in
+	/// \param begin Offset of the first byte of the row
+	/// \param end Offset past the last byte of the row
+	Fle_Listview_Csv_Item(std::shared_ptr<const Fle_Csv_Mapping> mapping, size_t begin, size_t end);
+
+	/// Get a cell without copying it. Quoted cells are returned without the
+	/// surrounding quotes, but with any doubled quotes inside them.
+	///
+	/// \param column Column of the cell, 0 for the name
+	/// \param text Set to the first character of the cell
+	/// \param length Set to the length of the cell
+	/// \return Whether the row has the column
+	bool get_cell(int column, const char*& text, size_t& length) const;
+	/// Get a copy of a cell, with doubled quotes replaced by single ones
+	///
+	/// \param column Column of the cell, 0 for the name
+	/// \return Cell text, empty if the row doesn't have the column
+	std::string get_cell_text(int column) const;
+	/// Get a copy of the cell of a property
+	///
+	/// \param property Property index
+	/// \return Cell text
+	std::string get_property_text(int property) const override;
+};
+
+/** \class Fle_Listview_Csv_Source
+	\brief Shows a CSV or TSV file in a listview without parsing it up front.
+
+	The file is memory-mapped and it's rows are found by a background thread,
+	which adds them to the listview with Fle_Listview::post_item() as it goes,
+	so the first rows appear right away and the rest follow while the file is
+	being read. Each row becomes a Fle_Listview_Csv_Item reading it's cells
+	from the mapping. Line breaks inside quoted cells don't end a row.
+
+	The first row may be used as the column headers, in which case the first
+	column becomes the name column and the others are added as properties,
+	so the listview should not have properties of it's own.
+	A source opens only one file: the listview keeps it's columns and rows
+	after close(), so use a new source and listview for another file.
+	As with post_item(), Fl::lock() must have been called before Fl::run().
+**/
+class Fle_Listview_Csv_Source
+{
+	Fle_Listview* m_listview; ///< Listview the rows are added to
+	std::shared_ptr<const Fle_Csv_Mapping> m_mapping; ///< Open file, nullptr if closed
+	std::thread m_indexer; ///< Thread finding the rows
+	std::atomic<bool> m_stopping; ///< Whether the indexer should stop
+	std::atomic<bool> m_indexing; ///< Whether the indexer is still running
+	std::atomic<int> m_rowCount; ///< Rows found so far
+	int m_columnCount; ///< Columns of the first row
+	size_t m_firstRow; ///< Offset of the first row posted as an item
+	bool m_opened; ///< Whether a file was opened, after which open() fails
+
+	/// Finds the rows and posts an item for each one
+	void index_rows();
+
+public:
+	/// Constructs a source for a listview
+	///
+	/// \param listview Listview the rows are added to
+	Fle_Listview_Csv_Source(Fle_Listview* listview);
+	/// Stops the indexer and closes the file. Must happen before the listview
+	/// is destroyed, as the indexer adds items to it.
+	~Fle_Listview_Csv_Source();
+
+	/// Open a file and start adding it's rows to the listview.
+	/// Only one file can be opened, even after close().
+	///
+	/// \param path Path of the file
+	/// \param separator Cell separator, or 0 to use a tab if the first row has one and a comma otherwise
+	/// \param header Whether the first row holds the column headers
+	/// \return Whether the file could be opened, false for an empty file or if a file was opened before
+	bool open(const char* path, char separator = 0, bool header = true);
+	/// Stop adding rows and release the file. The mapping is unmapped once
+	/// the items showing it's rows are deleted as well.
+	void close();
+	/// Get whether rows are still being found
+	///
+	/// \return Whether the indexer is running
+	bool is_indexing() const;
+	/// Get the number of rows found so far, without the header row
+	///
+	/// \return Row count
+	int get_row_count() const;
+	/// Get the number of columns of the first row
+	///
+	/// \return Column count
+	int get_column_count() const;
+	/// Get the separator of the open file
+	///
+	/// \return Cell separator, 0 if no file is open
+	char get_separator() const;
+};
+
+#endif
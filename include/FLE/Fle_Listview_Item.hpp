@@ -5,6 +5,7 @@
 #include <FL/Fl_Pixmap.H>
 
 #include <string>
+#include <vector>
 
 /// \enum Fle_Listview_Display_Mode
 /// Listview display modes
@@ -18,6 +19,16 @@ enum Fle_Listview_Display_Mode
 	FLE_LISTVIEW_DISPLAY_TOOLBOX,
 };
 
+/// \enum Fle_Listview_Dnd_Format
+/// Drag and drop payload formats
+///
+enum Fle_Listview_Dnd_Format
+{
+	FLE_LISTVIEW_DND_NONE = 0, ///< The application calls Fl::copy() on FLE_LISTVIEW_REASON_DND_START
+	FLE_LISTVIEW_DND_TEXT, ///< Item names, one per line
+	FLE_LISTVIEW_DND_URI_LIST, ///< file:// URIs, one per line, as in text/uri-list
+};
+
 class Fle_Listview;
 
 /** \class Fle_Listview_Item
@@ -35,25 +46,45 @@ class Fle_Listview;
 class Fle_Listview_Item
 {
 	friend class Fle_Listview;
+	friend class Fle_Icon_Loader;
 
 	Fle_Listview_Display_Mode m_displayMode;
 
 	std::string m_name; ///< Internal name of the item
 	std::string m_displayName; ///< Display name
 	std::string m_tooltip; ///< Custom tooltip for the item
+	std::string m_iconKey; ///< Custom key passed to the icon provider
+	std::string m_group; ///< Key of the group the item is shown in
 	bool m_selected; ///< Whether the item is selected
 	bool m_focused; ///< Whether the item is focused
 	Fl_Color m_textcolor; ///< Text color
 	Fl_Color m_bgcolor;  ///< Background color
 	Fl_Pixmap* m_smallIcon; ///< 16x16 icon
 	Fl_Pixmap* m_bigIcon; ///< 32x32 icon
+	Fl_Image* m_loadedSmallIcon; ///< 16x16 icon supplied by the icon provider
+	Fl_Image* m_loadedBigIcon; ///< 32x32 icon supplied by the icon provider
+	int m_iconRequests; ///< Icon sizes already requested from the icon provider
+	int m_labelWidth; ///< Label width last measured by the listview, -1 if not measured. Only valid while the listview keeps it's label widths
+	int m_rowHeight; ///< Height of the row in details mode
+	int m_layoutGeneration; ///< Listview layout generation the position was computed in
 	Fle_Listview* m_listview; ///< Pointer to the listview
+	Fle_Listview_Item* m_postNext; ///< Next item in the listview's queue of posted items
+	Fle_Listview_Item* m_treeParent; ///< Parent item in tree-list mode, nullptr for a root item
+	std::vector<Fle_Listview_Item*> m_children; ///< Child items in tree-list mode, owned by the item
+	int m_treeDepth; ///< Depth in tree-list mode, 0 for a root item
+	bool m_expandable; ///< Whether the item has or may have children
+	bool m_expanded; ///< Whether the children are shown
+	bool m_childrenLoaded; ///< Whether the listview has asked for the children
 	int m_x;
 	int m_y;
 	int m_w;
 	int m_h;
 
 	void set_display_name();
+	/// Get the image to draw as the small or big icon
+	Fl_Image* get_draw_icon(bool big) const;
+	/// Get the space left of the icon for the expand arrow and the depth in tree-list mode
+	int get_tree_indent() const;
 
 protected:
 	/// Set the display mode. You can use a custom one.
@@ -69,6 +100,10 @@ protected:
 	/// Get the rectangle containing the item's text.
 	virtual void get_text_xywh(int& X, int& Y, int& W, int& H);
 
+	/// Set the height of the item's row in details mode, before the item is
+	/// added to a listview. Afterwards, use Fle_Listview::set_row_height().
+	void set_row_height(int height);
+
 	/// Set whether the item is selected.
 	void set_selected(bool selected);
 
@@ -86,6 +121,12 @@ public:
 	/// 
 	/// \param name Name of the item
 	Fle_Listview_Item(const char* name);
+	/// Deletes the icons supplied by the icon provider and the child items.
+	virtual ~Fle_Listview_Item();
+	/// Create the default icons shared by all items. Items create them when
+	/// they are first constructed, which has to happen on the FLTK thread,
+	/// so call this before items are constructed on other threads.
+	static void create_default_icons();
 	/// Gets the listview.
 	///
 	/// \return Pointer to the listview
@@ -134,9 +175,77 @@ public:
 	///
 	/// \return Tooltip
 	const std::string& get_tooltip() const;
+	/// Get the text of a property, used when the listview is exported.
+	/// Usually this is overridden in a subclass along with draw_property().
+	///
+	/// \param property Property index
+	/// \return Property text, empty by default
+	virtual std::string get_property_text(int property) const;
+	/// Append the item to a drag and drop payload, without the line break.
+	/// By default the name is used as the text, and as the path of the URI
+	/// if it is an absolute path. Items whose name is relative append nothing
+	/// and are left out of URI lists, so subclasses knowing the full path of
+	/// their items should override this.
+	///
+	/// \param payload Payload the item is appended to
+	/// \param format Payload format
+	virtual void append_dnd_data(std::string& payload, Fle_Listview_Dnd_Format format) const;
+	/// Set a custom key passed to the listview icon provider. By default, it's name is used.
+	///
+	/// \param key New icon key
+	void set_icon_key(std::string key);
+	/// Get the icon key
+	///
+	/// \return Icon key
+	const std::string& get_icon_key() const;
+	/// Set the key of the group the item belongs to. Items sharing a key are
+	/// shown under one collapsible header when the listview groups rows. If the
+	/// item is already in a listview, call Fle_Listview::regroup_items() afterwards.
+	///
+	/// \param group New group key
+	void set_group(std::string group);
+	/// Get the group key
+	///
+	/// \return Group key, empty by default
+	const std::string& get_group() const;
 
 	int get_label_width() const;
 
+	/// Set whether the item shows an expand arrow in tree-list mode before
+	/// it's children are known. Adding a child makes the item expandable.
+	///
+	/// \param expandable Whether the item can be expanded
+	void set_expandable(bool expandable);
+	/// Get whether the item can be expanded in tree-list mode
+	///
+	/// \return Whether the item can be expanded
+	bool is_expandable() const;
+	/// Get whether the children of the item are shown in tree-list mode
+	///
+	/// \return Whether the item is expanded
+	bool is_expanded() const;
+	/// Get the parent item in tree-list mode
+	///
+	/// \return Parent item, or nullptr for a root item
+	Fle_Listview_Item* get_parent_item() const;
+	/// Get the depth in tree-list mode
+	///
+	/// \return Depth, 0 for a root item
+	int get_depth() const;
+	/// Get the number of child items added so far
+	///
+	/// \return Number of children
+	int get_child_count() const;
+	/// Get a child item
+	///
+	/// \param index Child index
+	/// \return Child item
+	Fle_Listview_Item* get_child(int index) const;
+	/// Get the height of the item's row in details mode
+	///
+	/// \return Row height, 20 by default
+	int get_row_height() const;
+
 	int x() const;
 	int y() const;
 	int w() const { return m_w; }
@@ -29,6 +29,9 @@ class Fle_Stack : public Fl_Group
     std::vector<int> m_widgetPreferredSizes; //< Preferred sizes of the widgets
     std::vector<int> m_widgetMaxSizes; //< Maximum sizes of the widgets
 
+    /// Frame scheduler callback positioning the children and redrawing
+    static void frame_cb(void* data, int work);
+
 protected:
     /// Overridden to remove the extra data associated with the widget
     /// and also to reposition other widgets so as to maintain tesselation.
@@ -53,6 +56,8 @@ protected:
     /// \param H The height of the stack.
     /// \param orientation The orientation of the stack.
     Fle_Stack(int X, int Y, int W, int H, Fle_Stack_Orientation orientation = FLE_STACK_VERTICAL);
+    /// Fle_Stack destructor.
+    ~Fle_Stack();
     
     /// Handles FLTK events for the stack.
     int handle(int e) override;
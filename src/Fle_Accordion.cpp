@@ -1,11 +1,18 @@
 #include <FLE/Fle_Accordion.hpp>
 #include <FLE/Fle_Accordion_Group.hpp>
+#include <FLE/Fle_Frame_Scheduler.hpp>
+
 Fle_Accordion::Fle_Accordion(int X, int Y, int W, int H, const char* l) : Fl_Scroll(X, Y, W, H, l), m_pack(X, Y, W, H, "")
 {  
     m_pack.type(Fl_Pack::VERTICAL);
     m_singleOpen = false;
 }
 
+Fle_Accordion::~Fle_Accordion()
+{
+    Fle_Frame_Scheduler::cancel(this);
+}
+
 void Fle_Accordion::fit_pack()
 {
     int sumH = 0;
@@ -31,29 +38,39 @@ void Fle_Accordion::fit_pack()
     redraw();
 }
 
+void Fle_Accordion::schedule_fit_pack()
+{
+    Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
+}
+
+void Fle_Accordion::frame_cb(void* data, int work)
+{
+    ((Fle_Accordion*)data)->fit_pack();
+}
+
 void Fle_Accordion::add_group(Fle_Accordion_Group* group)
 {
     m_pack.add(group);
-    fit_pack();
+    schedule_fit_pack();
 }
 
 void Fle_Accordion::insert_group(Fle_Accordion_Group* group, int index)
 {
     m_pack.insert(*group, index);
-    fit_pack();
+    schedule_fit_pack();
 }
 
 void Fle_Accordion::remove_group(Fle_Accordion_Group* group)
 {
     m_pack.remove(group);
-    fit_pack();
+    schedule_fit_pack();
 }
 
 void Fle_Accordion::remove_group(int index)
 {
     Fle_Accordion_Group* c = (Fle_Accordion_Group*)m_pack.child(index);
     m_pack.remove(c);
-    fit_pack();
+    schedule_fit_pack();
 
     delete c;
 }
@@ -71,5 +88,5 @@ void Fle_Accordion::close_all(Fle_Accordion_Group* except)
 void Fle_Accordion::resize(int X, int Y, int W, int H)
 {
     Fl_Scroll::resize(X, Y, W, H);
-    fit_pack();
+    schedule_fit_pack();
 }
\ No newline at end of file
@@ -53,7 +53,7 @@ void Fle_Accordion_Group::open()
     if(get_accordion()->single_open())
         get_accordion()->close_all(this);
 
-    get_accordion()->fit_pack();
+    get_accordion()->schedule_fit_pack();
 
     if(when())
     {
@@ -70,7 +70,7 @@ void Fle_Accordion_Group::close()
 
     m_child->hide();
 
-    get_accordion()->fit_pack();
+    get_accordion()->schedule_fit_pack();
 
     if(when())
     {
@@ -124,7 +124,7 @@ int Fle_Accordion_Group::handle(int event)
         {
             resize(x(), y(), w(), h() + dy);
             offsetY = ey;
-            get_accordion()->fit_pack();
+            get_accordion()->schedule_fit_pack();
             parent()->redraw();
             return 1;
         }
@@ -143,7 +143,7 @@ void Fle_Accordion_Group::min_height(int height)
     if(m_child->h() < m_minH)
     {
         m_child->resize(x(), y() + 20, w(), m_minH);
-        get_accordion()->fit_pack();
+        get_accordion()->schedule_fit_pack();
     }
 }
 
@@ -153,6 +153,6 @@ void Fle_Accordion_Group::max_height(int height)
     if(m_child->h() > m_maxH)
     {
         m_child->resize(x(), y() + 20, w(), m_maxH);
-        get_accordion()->fit_pack();
+        get_accordion()->schedule_fit_pack();
     }
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include <FLE/Fle_Dock_Host.hpp>
+#include <FLE/Fle_Frame_Scheduler.hpp>
+#include <FLE/Fle_Instrumentation.hpp>
 
 #include <algorithm>
 
@@ -39,6 +41,13 @@ Fle_Dock_Host::Fle_Dock_Host(int X, int Y, int W, int H, const char* l, int acti
 
 Fle_Dock_Host::~Fle_Dock_Host()
 {
+	Fle_Frame_Scheduler::cancel(this);
+}
+
+void Fle_Dock_Host::frame_cb(void* data, int work)
+{
+	// Layout changes in one event loop iteration report the minimum size once
+	((Fle_Dock_Host*)data)->calculate_min_size();
 }
 
 void Fle_Dock_Host::position_work_widget()
@@ -406,6 +415,8 @@ void Fle_Dock_Host::remove_empty_lines(int direction)
 
 void Fle_Dock_Host::find_edges()
 {
+	FLE_INSTRUMENT_SCOPE("Fle_Dock_Host::find_edges");
+
 	m_edges.clear();
 
 	std::list<std::list<std::list<Fle_Dock_Group*>>*> directions;
@@ -862,7 +873,7 @@ int Fle_Dock_Host::handle(int e)
 
 					position_work_widget();
 					//find_edges();
-					calculate_min_size();
+					Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
 
 					offsetX = Fl::event_x();
 					offsetY = Fl::event_y();
@@ -1235,7 +1246,7 @@ bool Fle_Dock_Host::add_dock_group(Fle_Dock_Group* group, int direction, int new
 		// Erase group from hidden list
 		m_hiddenGroups.remove(group);
 
-		calculate_min_size();
+		Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
 		find_edges();
 		position_work_widget();
 		return true;
@@ -1411,7 +1422,7 @@ void Fle_Dock_Host::detach(Fle_Dock_Group* group, bool addToDetached)
 	if(addToDetached)
 		m_detachedGroups.push_back(group);
 
-	calculate_min_size();
+	Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
 	find_edges();
 }
 
@@ -1420,7 +1431,7 @@ void Fle_Dock_Host::set_work_widget_min_size(int W, int H)
 	m_workWidgetMinW = W;
 	m_workWidgetMinH = H;
 
-	calculate_min_size();
+	Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
 }
 
 void Fle_Dock_Host::hide_group(Fle_Dock_Group* group)
@@ -1444,6 +1455,9 @@ void Fle_Dock_Host::show_group(Fle_Dock_Group* group)
 
 void Fle_Dock_Host::resize_direction(std::list<std::list<Fle_Dock_Group*>>* lines, int resizeDelta, int resizeDeltaSecondary)
 {
+	FLE_INSTRUMENT_SCOPE("Fle_Dock_Host::resize_direction");
+	FLE_INSTRUMENT_COUNT("Fle_Dock_Host::resize_direction lines", lines->size());
+
 	for (std::list<std::list<Fle_Dock_Group*>>::iterator it = lines->begin(); it != lines->end(); it++)
 	{
 		int deltaCopy = resizeDelta;
@@ -2077,6 +2091,8 @@ void Fle_Dock_Host::line_reset_preferred_sizes(std::list<Fle_Dock_Group*>* line)
 // Returns direction if managed to attach
 int Fle_Dock_Host::try_attach(Fle_Dock_Group* group, int screenX, int screenY, bool force, bool preview)
 {
+	FLE_INSTRUMENT_SCOPE("Fle_Dock_Host::try_attach");
+
 	// force argument is used to attach a non-detachable group even if all else fails
 	
 	// preview argument is used to calculate the xywh of the preview and draw it without
@@ -2189,7 +2205,7 @@ int Fle_Dock_Host::try_attach(Fle_Dock_Group* group, int screenX, int screenY, b
 		group->m_direction = addedToDirection;
 		find_edges();
 		if (needCalcMinSize)
-			calculate_min_size();
+			Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
 	}
 
 	if (m_nonDetachableDetachSavedLayout != nullptr)
@@ -0,0 +1,98 @@
+#include <FLE/Fle_Frame_Scheduler.hpp>
+
+#include <FL/Fl.H>
+
+// Work scheduling more work forever shouldn't hang the event loop
+#define FLE_FRAME_MAX_PASSES 8
+
+std::vector<Fle_Frame_Scheduler::Entry> Fle_Frame_Scheduler::s_entries;
+std::vector<Fle_Frame_Scheduler::Entry>* Fle_Frame_Scheduler::s_flushing = nullptr;
+bool Fle_Frame_Scheduler::s_checkAdded = false;
+
+void Fle_Frame_Scheduler::schedule(Fle_Frame_Callback* cb, void* data, int work)
+{
+	for (int i = 0; i < s_entries.size(); i++)
+	{
+		if (s_entries[i].data == data)
+		{
+			s_entries[i].work |= work;
+			return;
+		}
+	}
+
+	Entry entry;
+	entry.cb = cb;
+	entry.data = data;
+	entry.work = work;
+	s_entries.push_back(entry);
+
+	if (!s_checkAdded)
+	{
+		Fl::add_check(check_cb);
+		s_checkAdded = true;
+	}
+}
+
+void Fle_Frame_Scheduler::cancel(void* data)
+{
+	for (int i = 0; i < s_entries.size(); i++)
+	{
+		if (s_entries[i].data == data)
+		{
+			s_entries.erase(s_entries.begin() + i);
+			break;
+		}
+	}
+
+	// A widget destroyed by a callback during a flush must not be called after it
+	if (!s_flushing) return;
+
+	for (int i = 0; i < s_flushing->size(); i++)
+	{
+		if ((*s_flushing)[i].data == data) (*s_flushing)[i].cb = nullptr;
+	}
+}
+
+int Fle_Frame_Scheduler::get_scheduled(void* data)
+{
+	for (int i = 0; i < s_entries.size(); i++)
+	{
+		if (s_entries[i].data == data) return s_entries[i].work;
+	}
+
+	return 0;
+}
+
+void Fle_Frame_Scheduler::flush()
+{
+	// Flushing from a scheduled callback would run the work of the outer flush twice
+	if (s_flushing) return;
+
+	for (int pass = 0; pass < FLE_FRAME_MAX_PASSES && !s_entries.empty(); pass++)
+	{
+		// Callbacks may schedule or cancel work, the entries are taken first
+		std::vector<Entry> entries;
+		entries.swap(s_entries);
+
+		s_flushing = &entries;
+
+		for (int i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].cb) entries[i].cb(entries[i].data, entries[i].work);
+		}
+
+		s_flushing = nullptr;
+	}
+}
+
+void Fle_Frame_Scheduler::check_cb(void* data)
+{
+	flush();
+
+	// The check stays installed only while there is work
+	if (s_entries.empty())
+	{
+		Fl::remove_check(check_cb);
+		s_checkAdded = false;
+	}
+}
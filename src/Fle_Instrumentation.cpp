@@ -0,0 +1,210 @@
+#include <FLE/Fle_Instrumentation.hpp>
+
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+
+// Enough for a few minutes of interaction, about 40MB
+#define FLE_INSTRUMENTATION_MAX_EVENTS (1 << 20)
+
+namespace
+{
+	// A scope run or a counter change, in nanoseconds since the epoch
+	struct Event
+	{
+		const char* name;
+		int thread;
+		long long start;
+		long long duration; // -1 for a counter
+		long long value; // Counter total after the change
+	};
+
+	std::mutex s_mutex;
+	std::vector<Fle_Instrumentation_Stats> s_stats;
+	std::vector<Event> s_events;
+	std::vector<std::thread::id> s_threads; // Index + 1 is the trace thread id
+	long long s_droppedEvents = 0;
+	std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	// Names are usually literals, so the pointer is compared first. The same
+	// literal may have different addresses in different translation units.
+	Fle_Instrumentation_Stats& find_stats(const char* name)
+	{
+		for (int i = 0; i < s_stats.size(); i++)
+		{
+			if (s_stats[i].name == name) return s_stats[i];
+		}
+		for (int i = 0; i < s_stats.size(); i++)
+		{
+			if (strcmp(s_stats[i].name, name) == 0) return s_stats[i];
+		}
+
+		Fle_Instrumentation_Stats stats;
+		stats.name = name;
+		stats.calls = 0;
+		stats.totalNs = 0;
+		stats.maxNs = 0;
+		stats.count = 0;
+		s_stats.push_back(stats);
+
+		return s_stats.back();
+	}
+
+	int thread_index()
+	{
+		std::thread::id id = std::this_thread::get_id();
+		for (int i = 0; i < s_threads.size(); i++)
+		{
+			if (s_threads[i] == id) return i + 1;
+		}
+
+		s_threads.push_back(id);
+		return (int)s_threads.size();
+	}
+
+	void add_event(const char* name, long long start, long long duration, long long value)
+	{
+		if (s_events.size() >= FLE_INSTRUMENTATION_MAX_EVENTS)
+		{
+			s_droppedEvents++;
+			return;
+		}
+
+		Event event;
+		event.name = name;
+		event.thread = thread_index();
+		event.start = start;
+		event.duration = duration;
+		event.value = value;
+		s_events.push_back(event);
+	}
+
+	void write_json_string(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') fputc('\\', file);
+			if ((unsigned char)*c >= 0x20) fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+}
+
+Fle_Instrumentation::Scope::Scope(const char* name)
+{
+	m_name = name;
+	m_start = std::chrono::steady_clock::now();
+}
+
+Fle_Instrumentation::Scope::~Scope()
+{
+	add_scope(m_name, m_start, std::chrono::steady_clock::now());
+}
+
+void Fle_Instrumentation::add_scope(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	long long startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - s_epoch).count();
+	long long duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	Fle_Instrumentation_Stats& stats = find_stats(name);
+	stats.calls++;
+	stats.totalNs += duration;
+	if (duration > stats.maxNs) stats.maxNs = duration;
+
+	add_event(name, startNs, duration, 0);
+}
+
+void Fle_Instrumentation::add_count(const char* name, long long value)
+{
+	long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	Fle_Instrumentation_Stats& stats = find_stats(name);
+	stats.calls++;
+	stats.count += value;
+
+	add_event(name, now, -1, stats.count);
+}
+
+bool Fle_Instrumentation::is_enabled()
+{
+#ifdef FLE_INSTRUMENTATION
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Fle_Instrumentation::get_stats(std::vector<Fle_Instrumentation_Stats>& stats)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	stats.insert(stats.end(), s_stats.begin(), s_stats.end());
+}
+
+bool Fle_Instrumentation::get_stats(const char* name, Fle_Instrumentation_Stats& stats)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	for (int i = 0; i < s_stats.size(); i++)
+	{
+		if (strcmp(s_stats[i].name, name) == 0)
+		{
+			stats = s_stats[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+long long Fle_Instrumentation::get_dropped_events()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	return s_droppedEvents;
+}
+
+void Fle_Instrumentation::reset()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	s_stats.clear();
+	s_events.clear();
+	s_threads.clear();
+	s_droppedEvents = 0;
+}
+
+bool Fle_Instrumentation::write_chrome_trace(const char* path)
+{
+	FILE* file = fopen(path, "wb");
+	if (!file) return false;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	// Timestamps and durations are in microseconds
+	fputs("{\"traceEvents\":[\n", file);
+	for (size_t i = 0; i < s_events.size(); i++)
+	{
+		const Event& event = s_events[i];
+
+		fputs("{\"name\":", file);
+		write_json_string(file, event.name);
+
+		if (event.duration >= 0)
+			fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", event.start / 1000.0, event.duration / 1000.0, event.thread);
+		else
+			fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}}", event.start / 1000.0, event.thread, event.value);
+
+		fputs(i + 1 < s_events.size() ? ",\n" : "\n", file);
+	}
+	fputs("],\"displayTimeUnit\":\"ns\"}\n", file);
+
+	bool written = !ferror(file);
+	return fclose(file) == 0 && written;
+}
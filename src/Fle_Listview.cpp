@@ -1,11 +1,25 @@
 #include <FLE/Fle_Listview.hpp>
+#include <FLE/Fle_Frame_Scheduler.hpp>
+#include <FLE/Fle_Instrumentation.hpp>
+#include <FLE/Fle_Schemes.hpp>
 
 #include <FL/Fl_Window.H>
 #include <FL/fl_draw.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_RGB_Image.H>
+#include <FL/Fl_Input.H>
 
 #include <algorithm>
+#include <functional>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
 
 bool intersect(int ax1, int ay1, int ax2, int ay2, int bx1, int by1, int bx2, int by2)
 {
@@ -23,1327 +37,4675 @@ bool intersect(int ax1, int ay1, int ax2, int ay2, int bx1, int by1, int bx2, in
 	return true;
 }
 
-void Fle_Listview::scr_callback(Fl_Widget* w, void* data)
-{
-	Fle_Listview* lv = (Fle_Listview*)w->parent();
-	bool horizontal = data == (void*)1;
-	
-	// Update only if currently scrolled past max
-	if (horizontal)
-	{
-		if (lv->m_hscrollbar.value() > lv->m_itemsBBoxX - lv->w())
-			lv->update_scrollbars();
-	}
-	else
-	{
-		if(lv->m_vscrollbar.value() > lv->m_itemsBBoxY - lv->h())
-			lv->update_scrollbars();
-	}
+// Interval between frames of work spread over several event loop iterations
+#define FLE_LISTVIEW_FRAME_TIME (1.0 / 60.0)
 
+// Time the pointer has to rest before the item tooltip is updated
+#define FLE_LISTVIEW_TOOLTIP_DELAY 0.1
 
-	lv->listview_redraw();
-}
-
-Fle_Listview::Fle_Listview(int X, int Y, int W, int H, const char* l) : Fl_Group(X, Y, W, H, l),
-m_hscrollbar(0, 0, 0, 0, 0), m_vscrollbar(0, 0, 0, 0, 0)
-{
-	m_displayMode = FLE_LISTVIEW_DISPLAY_DETAILS;
-	m_state = FLE_LISTVIEW_DETAILS_HIGHLIGHT | FLE_LISTVIEW_REDRAW | FLE_LISTVIEW_DND;
-	m_headersHeight = 20;
-	m_focusedItem = -1;
-	m_lastSelectedItem = -1;
-	m_itemsBBoxX = 0;
-	m_itemsBBoxY = 0;
-	m_nameDisplayText = "Name";
-	m_nameHeaderMinWidth = 100;
-	m_sortedByProperty = -2;
-	m_margin = 5;
-	m_headersColor = FL_BACKGROUND_COLOR;
-	m_hscrollbar.type(FL_HORIZONTAL);
-	m_hscrollbar.when(FL_WHEN_CHANGED);
-	m_vscrollbar.when(FL_WHEN_CHANGED);
-	m_hscrollbar.callback(scr_callback, (void*)1);
-	m_vscrollbar.callback(scr_callback, (void*)0);
-	set_property_order({});
-	set_property_widths({});
-	set_display_mode(FLE_LISTVIEW_DISPLAY_DETAILS);
+// Damage of the scrolled columns by horizontal scrolling. The pinned strip is
+// reused only if nothing else damaged the listview, so any redraw() rebuilds it.
+#define FLE_LISTVIEW_DAMAGE_SCROLLED FL_DAMAGE_USER1
 
-	end();
-	when(FL_WHEN_CHANGED);
+// Listviews alive on the FLTK thread, checked by Fl::awake callbacks
+static std::vector<Fle_Listview*> s_listviews;
+// Listview whose items are being dragged, during Fl::dnd()
+static Fle_Listview* s_dndSource = nullptr;
 
-	box(FL_DOWN_BOX);
-	color(FL_BACKGROUND2_COLOR);
-}
+// Bits of Fle_Listview_Item::m_iconRequests
+#define FLE_ICON_REQUEST_SMALL 1
+#define FLE_ICON_REQUEST_BIG 2
 
-Fle_Listview::~Fle_Listview()
+struct Fle_Icon_Request
 {
-}
+	Fle_Listview_Item* item; // Used only as a key on the worker threads
+	unsigned int ticket;
+	std::string key;
+	int size;
+};
 
-void Fle_Listview::arrange_items()
+struct Fle_Icon_Result
 {
-	if (w() == 0 || h() == 0) return;
-
-	Fle_Listview_Display_Mode mode = get_display_mode();
+	Fle_Listview_Item* item;
+	unsigned int ticket;
+	int size;
+	Fl_RGB_Image* image;
+};
 
-	int X = 0;
-	int Y = (mode == FLE_LISTVIEW_DISPLAY_DETAILS ? m_headersHeight : 0);
-	int W = 0;
-	int H = 0;
+class Fle_Icon_Loader
+{
+public:
+	// Loaders alive on the FLTK thread, checked by awake_cb
+	static std::vector<Fle_Icon_Loader*> s_loaders;
+
+	Fle_Listview* m_listview;
+	Fle_Listview_Icon_Provider* m_provider;
+	std::vector<std::thread> m_workers;
+
+	// Guarded by m_mutex
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<Fle_Icon_Request> m_pending;
+	std::vector<Fle_Icon_Result> m_finished;
+	bool m_stopping;
+	bool m_awakePosted;
+
+	// FLTK thread only
+	std::map<std::pair<Fle_Listview_Item*, int>, unsigned int> m_inFlight;
+	unsigned int m_nextTicket;
+
+	Fle_Icon_Loader(Fle_Listview* listview, Fle_Listview_Icon_Provider* provider, int threads)
+	{
+		m_listview = listview;
+		m_provider = provider;
+		m_stopping = false;
+		m_awakePosted = false;
+		m_nextTicket = 0;
 
-	recalc_item_column_width();
-	int widest = m_columnWidth;
-	int columnSum = 0;
+		s_loaders.push_back(this);
 
-	m_itemsBBoxX = 0;
-	m_itemsBBoxY = 0;
+		if (threads < 1) threads = 1;
+		for (int i = 0; i < threads; i++)
+		{
+			m_workers.push_back(std::thread(&Fle_Icon_Loader::worker, this));
+		}
+	}
 
-	for (int i = 0; i < m_items.size(); i++)
+	~Fle_Icon_Loader()
 	{
-		Fle_Listview_Item* item = m_items[i];
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_condition.notify_all();
 
-		switch (mode)
+		for (int i = 0; i < m_workers.size(); i++)
 		{
-		case FLE_LISTVIEW_DISPLAY_ICONS:
-			W = 76;
-			H = 76;
-			if (X + W > w() - Fl::scrollbar_size() - (2 * m_margin))
-			{
-				X = 0;
-				Y += 76;
-			}
-			break;
-		case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
-			H = 20;
-			W = widest;
-			if (X + W > w() - Fl::scrollbar_size() - (2 * m_margin))
-			{
-				X = 0;
-				Y += 20;
-			}
-			break;
-		case FLE_LISTVIEW_DISPLAY_DETAILS:
-			H = 20;
-			W = w() - (2 * m_margin);
+			m_workers[i].join();
+		}
 
-			// At this point in time the scrollbar may or may not be visible
-			// need to check if it WILL be visible
-			if (m_items.size() * 20 >= h()) W -= Fl::scrollbar_size();
-			break;
-		case FLE_LISTVIEW_DISPLAY_LIST:
-			W = widest;
-			H = 20;
-			if (Y + H > h() - Fl::scrollbar_size() - (2 * m_margin))
-			{
-				X += widest;
-				Y -= columnSum;
-				columnSum = 0;
-			}
-			columnSum += H;
-			break;
-		case FLE_LISTVIEW_DISPLAY_TOOLBOX:
-			W = 32;
-			H = 32;
-			if (X + W > w() - Fl::scrollbar_size() - (2 * m_margin))
-			{
-				X = 0;
-				Y += 32;
-			}
-			break;
+		for (int i = 0; i < m_finished.size(); i++)
+		{
+			delete m_finished[i].image;
 		}
 
-		item->resize(X, Y, W, H);
+		s_loaders.erase(std::find(s_loaders.begin(), s_loaders.end(), this));
+	}
 
-		if (X + W > m_itemsBBoxX) m_itemsBBoxX = X + W;
-		if (Y + H > m_itemsBBoxY) m_itemsBBoxY = Y + H;
+	static int request_bit(int size)
+	{
+		return size == 32 ? FLE_ICON_REQUEST_BIG : FLE_ICON_REQUEST_SMALL;
+	}
+
+	void request(Fle_Listview_Item* item, int size)
+	{
+		item->m_iconRequests |= request_bit(size);
+
+		Fle_Icon_Request request;
+		request.item = item;
+		request.ticket = ++m_nextTicket;
+		request.key = item->get_icon_key();
+		request.size = size;
+
+		m_inFlight[std::make_pair(item, size)] = request.ticket;
 
-		switch (mode)
 		{
-		case FLE_LISTVIEW_DISPLAY_ICONS:
-			X += 76;
-			break;
-		case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
-			X += widest;
-			break;
-		case FLE_LISTVIEW_DISPLAY_DETAILS:
-		case FLE_LISTVIEW_DISPLAY_LIST:
-			Y += 20;
-			break;
-		case FLE_LISTVIEW_DISPLAY_TOOLBOX:
-			X += 32;
-			break;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pending.push_back(request);
 		}
+		m_condition.notify_one();
 	}
 
-	m_state &= ~FLE_LISTVIEW_NEEDS_ARRANGING;
+	// Cancel the pending requests of items not in the sorted wanted vector
+	void retain(const std::vector<Fle_Listview_Item*>& wanted)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
 
-	update_scrollbars();
+		for (std::deque<Fle_Icon_Request>::iterator it = m_pending.begin(); it != m_pending.end();)
+		{
+			if (std::binary_search(wanted.begin(), wanted.end(), it->item))
+			{
+				it++;
+				continue;
+			}
 
-	listview_redraw();
-}
+			it->item->m_iconRequests &= ~request_bit(it->size);
+			m_inFlight.erase(std::make_pair(it->item, it->size));
+			it = m_pending.erase(it);
+		}
+	}
 
-void Fle_Listview::keyboard_select(int key)
-{	
-	if(m_items.size() <= 1) return;
+	// Forget all requests of an item that is being removed from the listview
+	void cancel(Fle_Listview_Item* item)
+	{
+		m_inFlight.erase(std::make_pair(item, 16));
+		m_inFlight.erase(std::make_pair(item, 32));
+		item->m_iconRequests = 0;
 
-	if (m_focusedItem == -1) m_focusedItem = 0;
+		std::lock_guard<std::mutex> lock(m_mutex);
 
-	int itemToFocus = -1;
-	int itemWidth = m_items[m_focusedItem]->w();
+		for (std::deque<Fle_Icon_Request>::iterator it = m_pending.begin(); it != m_pending.end();)
+		{
+			if (it->item == item)
+				it = m_pending.erase(it);
+			else
+				it++;
+		}
+	}
 
-	switch (get_display_mode())
+	void cancel_all()
 	{
-	case FLE_LISTVIEW_DISPLAY_LIST:
-		if (key == FL_Right)
-			itemToFocus = m_focusedItem + (int)((h() - (2 * m_margin) - Fl::scrollbar_size()) / 20);
-		if (key == FL_Left)
-			itemToFocus = m_focusedItem - (int)((h() - (2 * m_margin) - Fl::scrollbar_size()) / 20);
-	case FLE_LISTVIEW_DISPLAY_DETAILS:
-		if (key == FL_Down)
-			itemToFocus = m_focusedItem + 1;
-		if (key == FL_Up)
-			itemToFocus = m_focusedItem - 1;
-		break;
-	case FLE_LISTVIEW_DISPLAY_TOOLBOX:
-	case FLE_LISTVIEW_DISPLAY_ICONS:
-	case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
-		if (key == FL_Right)
-			itemToFocus = m_focusedItem + 1;
-		if (key == FL_Left)
-			itemToFocus = m_focusedItem - 1;
-		if (key == FL_Down)
-			itemToFocus = m_focusedItem + (int)((w() - (2 * m_margin) - Fl::scrollbar_size()) / itemWidth);
-		if (key == FL_Up)
-			itemToFocus = m_focusedItem - (int)((w() - (2 * m_margin) - Fl::scrollbar_size()) / itemWidth);
-		break;
+		m_inFlight.clear();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.clear();
 	}
 
-	if (itemToFocus < 0) return;
-	if (itemToFocus > m_items.size() - 1) return;
+	void worker()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
 
-	set_focused(itemToFocus);
-}
+		while (true)
+		{
+			while (!m_stopping && m_pending.empty())
+				m_condition.wait(lock);
 
-void Fle_Listview::get_grid_xy_at(int X, int Y, int& gridX, int& gridY)
-{
-	gridX = 0;
-	gridY = 0;
-	
-	int scrX = m_hscrollbar.value();
-	int scrY = m_vscrollbar.value();
+			if (m_stopping) return;
 
-	Fle_Listview_Display_Mode mode = get_display_mode();
+			Fle_Icon_Request request = m_pending.front();
+			m_pending.pop_front();
 
-	if (mode == FLE_LISTVIEW_DISPLAY_DETAILS)
-	{
-		gridY = (Y - y() - m_margin + scrY) / 20;
-	}
-	else if (mode == FLE_LISTVIEW_DISPLAY_ICONS)
-	{
-		gridX = (X - x() - m_margin + scrX) / 76;
-		gridY = (Y - y() - m_margin + scrY) / 76;
-	}
-	else if (mode == FLE_LISTVIEW_DISPLAY_TOOLBOX)
-	{
-		gridX = (X - x() - m_margin + scrX) / 32;
-		gridY = (Y - y() - m_margin + scrY) / 32;
+			lock.unlock();
+			Fle_Icon_Result result;
+			result.item = request.item;
+			result.ticket = request.ticket;
+			result.size = request.size;
+			result.image = m_provider->load_icon(request.key, request.size);
+			lock.lock();
+
+			m_finished.push_back(result);
+
+			if (!m_awakePosted)
+			{
+				m_awakePosted = true;
+				lock.unlock();
+				bool posted = Fl::awake(awake_cb, this) == 0;
+				lock.lock();
+				if (!posted) m_awakePosted = false;
+			}
+		}
 	}
-	else
+
+	static void awake_cb(void* data)
 	{
-		gridX = (X - x() - m_margin + scrX) / get_item(0)->w();
-		gridY = (Y - y() - m_margin + scrY) / 20;
-	}
-}
+		Fle_Icon_Loader* loader = (Fle_Icon_Loader*)data;
 
-void Fle_Listview::drag_select(int x1, int y1, int x2, int y2)
-{
-	if(!Fl::event_ctrl())
-		m_selected.clear();
+		if (std::find(s_loaders.begin(), s_loaders.end(), loader) == s_loaders.end()) return;
 
-	for (int i = 0; i < m_items.size(); i++)
+		loader->deliver();
+	}
+
+	// Hand the finished icons over to their items, on the FLTK thread
+	void deliver()
 	{
-		Fle_Listview_Item* item = get_item(i);
+		std::vector<Fle_Icon_Result> finished;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			finished.swap(m_finished);
+			m_awakePosted = false;
+		}
+
+		bool changed = false;
 
-		if(intersect(x1, y1, x2, y2, item->x(), item->y(), item->x() + item->w(), item->y() + item->h()))
+		for (int i = 0; i < finished.size(); i++)
 		{
-			if (item->is_selected())
+			Fle_Icon_Result& result = finished[i];
+			std::map<std::pair<Fle_Listview_Item*, int>, unsigned int>::iterator it = m_inFlight.find(std::make_pair(result.item, result.size));
+
+			// The request was cancelled, or the item is gone
+			if (it == m_inFlight.end() || it->second != result.ticket)
 			{
-				m_selected.push_back(i);
-				
-				// reselect callback
-				if (when() & FL_WHEN_CHANGED)
-					do_callback_for_item(item, FLE_LISTVIEW_REASON_RESELECTED);
+				delete result.image;
+				continue;
 			}
-			else
-			{
-				item->set_selected(true);
-				m_selected.push_back(i);
 
-				if (when() & FL_WHEN_CHANGED)
-					do_callback_for_item(item, FLE_LISTVIEW_REASON_SELECTED);
-			}
-		}
-		else if (item->is_selected() && !Fl::event_ctrl())
-		{
-			item->set_selected(false);
-			if (when() & FL_WHEN_CHANGED)
-				do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+			m_inFlight.erase(it);
+
+			if (result.image == nullptr) continue;
+
+			Fl_Image*& icon = result.size == 32 ? result.item->m_loadedBigIcon : result.item->m_loadedSmallIcon;
+			delete icon;
+			icon = result.image;
+			changed = true;
 		}
+
+		if (changed) m_listview->redraw();
 	}
-}
+};
 
-void Fle_Listview::update_scrollbars()
+std::vector<Fle_Icon_Loader*> Fle_Icon_Loader::s_loaders;
+
+#define FLE_EXPORT_BUFFER_SIZE (64 * 1024)
+#define FLE_EXPORT_BUFFERS 4
+#define FLE_EXPORT_SLICE_TIME 0.008
+
+// Formats exported rows on the FLTK thread into a fixed set of buffers, which
+// a worker thread writes to the file and hands back to be reused
+class Fle_Listview_Exporter
 {
-	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST)
+public:
+	FILE* m_file;
+	Fle_Listview_Export_Format m_format;
+	Fle_Listview_Export_Callback* m_callback;
+	void* m_callbackData;
+	std::thread m_writer;
+
+	// FLTK thread only
+	std::vector<Fle_Listview_Item*> m_rows; // Rows in the order they are written
+	std::vector<int> m_properties; // Exported properties, in column order
+	std::vector<std::string> m_headers; // Column headers, the name column's first
+	int m_nextRow;
+	bool m_queuedLast;
+	std::string m_buffer; // Buffer being filled
+
+	// Guarded by m_mutex
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::string> m_full; // Buffers waiting to be written
+	std::vector<std::string> m_free; // Written buffers ready to be filled again
+	bool m_closing; // No more buffers will be queued
+	bool m_cancelled;
+	bool m_failed;
+	bool m_done; // The file has been closed
+
+	Fle_Listview_Exporter(FILE* file, Fle_Listview_Export_Format format, Fle_Listview_Export_Callback* cb, void* data)
 	{
-		m_vscrollbar.hide();
-		if (m_itemsBBoxX + m_hscrollbar.value() > w() || m_hscrollbar.value() != 0)
+		m_file = file;
+		m_format = format;
+		m_callback = cb;
+		m_callbackData = data;
+		m_nextRow = 0;
+		m_queuedLast = false;
+		m_closing = false;
+		m_cancelled = false;
+		m_failed = false;
+		m_done = false;
+
+		m_buffer.reserve(FLE_EXPORT_BUFFER_SIZE);
+		m_free.resize(FLE_EXPORT_BUFFERS - 1);
+		for (int i = 0; i < m_free.size(); i++)
 		{
-			m_hscrollbar.show();
-			m_hscrollbar.resize(x() + Fl::box_dx(box()), y() + h() - Fl::scrollbar_size() - Fl::box_dy(box()), w() - Fl::box_dw(box()), Fl::scrollbar_size());
-			m_hscrollbar.value(m_hscrollbar.value(), w(), 0, m_itemsBBoxX + (2 * m_margin));
+			m_free[i].reserve(FLE_EXPORT_BUFFER_SIZE);
 		}
-		else
-			m_hscrollbar.hide();
 	}
-	else if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS)
+
+	~Fle_Listview_Exporter()
 	{
-		m_hscrollbar.hide();
-		if (m_itemsBBoxY > h() - m_headersHeight + m_vscrollbar.value() || m_vscrollbar.value() != 0)
+		if (m_writer.joinable())
 		{
-			m_vscrollbar.show();
-			m_vscrollbar.resize(x() + w() - Fl::scrollbar_size() - Fl::box_dx(box()), y() + Fl::box_dy(box()) + m_headersHeight, Fl::scrollbar_size(), h() - Fl::box_dh(box()) - m_headersHeight);
-			m_vscrollbar.value(m_vscrollbar.value(), h() - m_headersHeight, 0, m_itemsBBoxY - m_headersHeight + (2 * m_margin));
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_cancelled = true;
+				m_closing = true;
+			}
+			m_condition.notify_all();
+
+			m_writer.join();
 		}
-		else
-			m_vscrollbar.hide();
+
+		if (m_file) fclose(m_file);
 	}
-	else
+
+	void start()
 	{
-		m_hscrollbar.hide();
-		if (m_itemsBBoxY > h() + m_vscrollbar.value() || m_vscrollbar.value() != 0)
+		if (m_format != FLE_LISTVIEW_EXPORT_JSONL)
 		{
-			m_vscrollbar.show();
-			m_vscrollbar.resize(x() + w() - Fl::scrollbar_size() - Fl::box_dx(box()), y() + Fl::box_dy(box()), Fl::scrollbar_size(), h() - Fl::box_dh(box()));
-			m_vscrollbar.value(m_vscrollbar.value(), h(), 0, m_itemsBBoxY + (2 * m_margin));
+			for (int i = 0; i < m_headers.size(); i++)
+			{
+				append_field(m_headers[i], i == 0);
+			}
+			m_buffer += '\n';
 		}
-		else
-			m_vscrollbar.hide();
+
+		m_writer = std::thread(&Fle_Listview_Exporter::writer, this);
 	}
-}
 
-void Fle_Listview::recalc_item_column_width()
-{
-	int W;
-	switch (get_display_mode())
+	void append_escaped_json(const std::string& text)
 	{
-	default:
-		m_columnWidth = 0;
-		break;
-	case FLE_LISTVIEW_DISPLAY_DETAILS:
-		m_columnWidth = w() - Fl::scrollbar_size() - (2 * m_margin);
-		for (int i = 0; i < m_propertyOrder.size(); i++)
+		m_buffer += '"';
+		for (int i = 0; i < text.size(); i++)
 		{
-			m_columnWidth -= get_property_header_width(m_propertyOrder[i]);
+			unsigned char c = text[i];
+			switch (c)
+			{
+			case '"': m_buffer += "\\\""; break;
+			case '\\': m_buffer += "\\\\"; break;
+			case '\n': m_buffer += "\\n"; break;
+			case '\r': m_buffer += "\\r"; break;
+			case '\t': m_buffer += "\\t"; break;
+			default:
+				if (c < 0x20)
+				{
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+					m_buffer += escaped;
+				}
+				else
+				{
+					m_buffer += (char)c;
+				}
+			}
 		}
+		m_buffer += '"';
+	}
 
-		break;
-	case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
-	case FLE_LISTVIEW_DISPLAY_LIST:
-		for (int i = 0; i < m_items.size(); i++)
+	void append_field(const std::string& text, bool first)
+	{
+		if (m_format == FLE_LISTVIEW_EXPORT_TSV)
 		{
-			Fle_Listview_Item* item = m_items[i];
-
-			W = item->get_label_width() + 16;
+			if (!first) m_buffer += '\t';
 
-			if (W > m_columnWidth) m_columnWidth = W;
+			// TSV has no quoting, separators inside a field become spaces
+			for (int i = 0; i < text.size(); i++)
+			{
+				char c = text[i];
+				m_buffer += (c == '\t' || c == '\n' || c == '\r') ? ' ' : c;
+			}
+			return;
 		}
 
-		if (m_columnWidth > 200) m_columnWidth = 200;
-		break;
-	}
-}
-
-void Fle_Listview::set_focused(Fle_Listview_Item* item, bool focused)
-{
-	set_focused(std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item)));
-}
+		if (!first) m_buffer += ',';
 
-void Fle_Listview::set_focused(int item)
-{
-	// Check for bounds and if already focused
-	if (item == m_focusedItem || item > m_items.size() - 1) return;
-	// Unfocus current
-	if (m_focusedItem != -1) m_items[m_focusedItem]->set_focus(false);
+		if (text.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			m_buffer += text;
+			return;
+		}
 
-	// Focus selected
-	m_focusedItem = item;
+		m_buffer += '"';
+		for (int i = 0; i < text.size(); i++)
+		{
+			if (text[i] == '"') m_buffer += '"';
+			m_buffer += text[i];
+		}
+		m_buffer += '"';
+	}
 
-	if(m_focusedItem == -1)
+	void append_row(Fle_Listview_Item* item)
 	{
-		listview_redraw();
-		return;
-	}
+		if (m_format == FLE_LISTVIEW_EXPORT_JSONL)
+		{
+			m_buffer += '{';
+			append_escaped_json(m_headers[0]);
+			m_buffer += ':';
+			append_escaped_json(item->get_name());
+			for (int i = 0; i < m_properties.size(); i++)
+			{
+				m_buffer += ',';
+				append_escaped_json(m_headers[i + 1]);
+				m_buffer += ':';
+				append_escaped_json(item->get_property_text(m_properties[i]));
+			}
+			m_buffer += "}\n";
+			return;
+		}
 
-	Fle_Listview_Item* i = m_items[item];
-	i->set_focus(true);
+		append_field(item->get_name(), true);
+		for (int i = 0; i < m_properties.size(); i++)
+		{
+			append_field(item->get_property_text(m_properties[i]), false);
+		}
+		m_buffer += '\n';
+	}
 
-	ensure_item_visible(i);
-}
+	// Queues the filled buffer and takes a free one, unless the writer is behind
+	bool queue_buffer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_free.empty()) return false;
 
-void Fle_Listview::handle_user_selection(Fle_Listview_Item* item, bool selected, bool scrollTo, bool keepSelected)
-{
-	bool ctrl = Fl::event_ctrl();
-	bool shift = Fl::event_shift();
-	int index = std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item));
+			m_full.push_back(std::move(m_buffer));
+			m_buffer = std::move(m_free.back());
+			m_free.pop_back();
+		}
+		m_condition.notify_one();
 
-	if (!keepSelected && (single_selection() || (!ctrl && !shift)))
-	{
-		deselect_all(selected ? index : -1);
+		return true;
 	}
 
-	if(shift && m_lastSelectedItem == -1) m_lastSelectedItem = 0;
-
-	if (shift && !single_selection())
+	// Formats rows for one time slice. Returns the status once the file is closed.
+	Fle_Listview_Export_Status step()
 	{
-		for (std::vector<int>::iterator it = m_selected.begin(); it != m_selected.end();)
 		{
-			if (*it >= std::min(m_lastSelectedItem, index + 1) && *it <= std::max(m_lastSelectedItem, index))
-			{
-				// Keep this selected
-				it++;
-				continue;
-			}
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_failed) return FLE_LISTVIEW_EXPORT_FAILED;
+			if (m_done) return FLE_LISTVIEW_EXPORT_FINISHED;
+		}
 
-			Fle_Listview_Item* item = get_item(*it);
-			item->set_selected(false);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-			if (when() & FL_WHEN_CHANGED)
-				do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+		while (m_nextRow < m_rows.size())
+		{
+			if (m_buffer.size() >= FLE_EXPORT_BUFFER_SIZE && !queue_buffer()) break;
 
-			it = m_selected.erase(it);
-			if(it == m_selected.end()) break;
+			append_row(m_rows[m_nextRow++]);
+
+			if ((m_nextRow & 63) == 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > FLE_EXPORT_SLICE_TIME)
+				break;
 		}
-		// "Bridge" from the last selected to currently selected
-		for (int i = std::min(m_lastSelectedItem, index); i <= std::max(m_lastSelectedItem, index); i++)
+
+		if (m_nextRow == m_rows.size() && !m_queuedLast)
 		{
-			select_item(i, true);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_buffer.empty()) m_full.push_back(std::move(m_buffer));
+				m_closing = true;
+			}
+			m_condition.notify_one();
+
+			m_queuedLast = true;
 		}
+
+		return FLE_LISTVIEW_EXPORT_RUNNING;
 	}
-	else
+
+	void writer()
 	{
-		select_item(index, selected);
-		m_lastSelectedItem = index;
-	}
+		std::unique_lock<std::mutex> lock(m_mutex);
 
-	if(scrollTo)
-		set_focused(index);
-	
-	listview_redraw();
-}
+		while (true)
+		{
+			while (!m_closing && m_full.empty())
+				m_condition.wait(lock);
 
-void Fle_Listview::set_details_mode(int mode)
-{
-	int oldState = m_state;
-	
-	m_state &= ~FLE_LISTVIEW_DETAILS_NONE;
-	m_state &= ~FLE_LISTVIEW_DETAILS_LINES;
-	m_state &= ~FLE_LISTVIEW_DETAILS_HIGHLIGHT;
+			if (m_cancelled || m_full.empty()) break;
 
-	m_state |= mode;
+			std::string buffer = std::move(m_full.front());
+			m_full.pop_front();
 
-	if (oldState != m_state) listview_redraw();
-}
+			lock.unlock();
+			bool written = fwrite(buffer.data(), 1, buffer.size(), m_file) == buffer.size();
+			lock.lock();
 
-int Fle_Listview::get_details_mode() const
-{
-	return m_state & FLE_LISTVIEW_DETAILS_NONE ? 0 : m_state & FLE_LISTVIEW_DETAILS_LINES ? 1 : 2;
-}
+			if (!written)
+			{
+				m_failed = true;
+				break;
+			}
 
-void Fle_Listview::set_headers_color(Fl_Color c)
-{
-	m_headersColor = c;
-}
+			buffer.clear();
+			m_free.push_back(std::move(buffer));
+		}
 
-void Fle_Listview::single_selection(bool s)
+		if (m_cancelled) return;
+
+		lock.unlock();
+		bool closed = fclose(m_file) == 0;
+		lock.lock();
+
+		m_file = nullptr;
+		if (!closed) m_failed = true;
+		m_done = true;
+	}
+};
+
+// Fenwick tree over the row heights of details mode. Finding the row at an
+// offset, the offset of a row and changing a row height are all O(log N).
+class Fle_Row_Index
 {
-	if (s)
+	std::vector<int> m_tree; // 1-based, entry i holds the heights of the (i & -i) rows ending at row i - 1
+	int m_highBit; // Highest power of two not above the number of rows
+
+public:
+	Fle_Row_Index()
 	{
-		m_state |= FLE_LISTVIEW_SINGLE_SELECTION;
+		m_highBit = 0;
 	}
-	else
-		m_state &= ~FLE_LISTVIEW_SINGLE_SELECTION;
-}
 
-void Fle_Listview::add_property_name(std::string name)
-{
-	m_propertyDisplayNames.push_back(std::move(name));
-}
+	// Rebuilds the tree from the item row heights, in O(N)
+	void build(const std::vector<Fle_Listview_Item*>& items)
+	{
+		int count = (int)items.size();
 
-void Fle_Listview::set_property_order(std::vector<int> order)
-{
-	m_propertyOrder = std::move(order);
+		m_tree.assign(count + 1, 0);
+		for (int i = 1; i <= count; i++)
+		{
+			m_tree[i] += items[i - 1]->get_row_height();
 
-	listview_redraw();
-}
+			int parent = i + (i & -i);
+			if (parent <= count) m_tree[parent] += m_tree[i];
+		}
 
-const std::vector<int>& Fle_Listview::get_property_order() const
-{
-	return m_propertyOrder;
-}
+		m_highBit = 1;
+		while (m_highBit * 2 <= count) m_highBit *= 2;
+		if (count == 0) m_highBit = 0;
+	}
 
-void Fle_Listview::set_property_widths(std::vector<int> widths)
-{
-	m_propertyHeaderMinWidths = widths;
-	m_propertyHeaderWidths = std::move(widths);
-}
+	int size() const
+	{
+		return m_tree.empty() ? 0 : (int)m_tree.size() - 1;
+	}
 
-void Fle_Listview::set_name_min_width(int width)
-{
-	m_nameHeaderMinWidth = width;
-}
+	// Changes the height of a row by delta
+	void add(int row, int delta)
+	{
+		for (int i = row + 1; i < (int)m_tree.size(); i += i & -i)
+			m_tree[i] += delta;
+	}
 
-int Fle_Listview::get_property_header_width(int property) const
-{
-	return m_propertyHeaderWidths[property];
-}
+	// Height of the first count rows
+	int prefix(int count) const
+	{
+		int sum = 0;
+		for (int i = count; i > 0; i -= i & -i)
+			sum += m_tree[i];
 
-void Fle_Listview::set_margin(int m)
-{
-	m_margin = m;
+		return sum;
+	}
 
-	update_scrollbars();
-	listview_redraw();
-}
+	// Height of a single row
+	int get(int row) const
+	{
+		return prefix(row + 1) - prefix(row);
+	}
 
-int Fle_Listview::get_margin() const
-{
-	return m_margin;
-}
+	int total() const
+	{
+		return prefix(size());
+	}
 
-int Fle_Listview::get_item_column_width() const
-{
-	return m_columnWidth;
-}
+	// Row containing the offset, size() if the offset is past the last row
+	int find(int offset) const
+	{
+		int row = 0;
+		for (int step = m_highBit; step > 0; step >>= 1)
+		{
+			if (row + step <= size() && m_tree[row + step] <= offset)
+			{
+				row += step;
+				offset -= m_tree[row];
+			}
+		}
 
-void Fle_Listview::set_name_text(std::string t)
-{
-	m_nameDisplayText = std::move(t);
-}
+		return row;
+	}
+};
 
-bool Fle_Listview::single_selection() const
+// Input used for in-place label editing, one per listview and reused by every edit
+class Fle_Label_Editor : public Fl_Input
 {
-	return m_state & FLE_LISTVIEW_SINGLE_SELECTION;
-}
+	Fle_Listview* m_listview;
 
-void Fle_Listview::dnd(bool dnd)
-{
-	if(dnd)
+public:
+	Fle_Label_Editor(Fle_Listview* listview) : Fl_Input(0, 0, 0, 0)
 	{
-		m_state |= FLE_LISTVIEW_DND;
+		m_listview = listview;
+		box(FL_BORDER_BOX);
 	}
-	else
-		m_state &= ~FLE_LISTVIEW_DND;
-}
 
-void Fle_Listview::item_tooltips(bool tooltips)
-{
-	if(tooltips)
+	int handle(int e) override
 	{
-		m_state |= FLE_LISTVIEW_ITEM_TOOLTIPS;
+		if (e == FL_KEYDOWN)
+		{
+			switch (Fl::event_key())
+			{
+			case FL_Escape:
+				m_listview->end_label_edit(false);
+				return 1;
+			case FL_Enter:
+			case FL_KP_Enter:
+				m_listview->end_label_edit(true);
+				return 1;
+			}
+		}
 
-		copy_tooltip("FLEET!!!");
-	}
-	else
-		m_state &= ~FLE_LISTVIEW_ITEM_TOOLTIPS;
-}
+		int ret = Fl_Input::handle(e);
 
-void Fle_Listview::do_callback_for_item(Fle_Listview_Item* item, Fle_Listview_Reason reason)
-{
-	m_callbackItem = item;
-	do_callback((Fl_Callback_Reason)reason);
-}
+		// Clicking elsewhere finishes the edit
+		if (e == FL_UNFOCUS) m_listview->end_label_edit(true);
 
-void Fle_Listview::listview_redraw()
-{
-	if(m_state & FLE_LISTVIEW_REDRAW) redraw();
-}
+		return ret;
+	}
+};
 
-void Fle_Listview::sort_items(bool ascending, int property)
+void Fle_Listview::scr_callback(Fl_Widget* w, void* data)
 {
-	// Remove focus and selections
-	set_focused(-1);
-
-	m_lastSelectedItem = -1;
+	Fle_Listview* lv = (Fle_Listview*)w->parent();
+	bool horizontal = data == (void*)1;
 
-	deselect_all();
+	lv->stop_scroll_animation();
+	lv->end_label_edit(true);
+	
+	// Update only if currently scrolled past max
+	if (horizontal)
+	{
+		if (lv->m_hscrollbar.value() > lv->m_itemsBBoxX - lv->w())
+			lv->update_scrollbars();
+	}
+	else
+	{
+		if(lv->m_vscrollbar.value() > lv->m_itemsBBoxY - lv->h())
+			lv->update_scrollbars();
+	}
 
-	std::sort(m_items.begin(), m_items.end(), [property, ascending](Fle_Listview_Item* a, Fle_Listview_Item* b) { return ascending ? b->is_greater(a, property) : a->is_greater(b, property); });
 
-	arrange_items();
+	int pinnedW = lv->get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS ? lv->get_pinned_width() : 0;
+	if (horizontal && pinnedW > 0 && (lv->m_state & FLE_LISTVIEW_REDRAW))
+	{
+		// Only the scrolled columns change, the pinned ones are copied
+		// from the strip drawn last time
+		lv->damage(FLE_LISTVIEW_DAMAGE_SCROLLED, lv->x() + pinnedW, lv->y(), lv->w() - pinnedW, lv->h());
+		return;
+	}
 
-	m_state |= ascending ? FLE_LISTVIEW_SORTED_ASCENDING : FLE_LISTVIEW_SORTED_DESCENDING;
-	m_state &= ascending ? ~FLE_LISTVIEW_SORTED_DESCENDING : ~FLE_LISTVIEW_SORTED_ASCENDING;
-	m_sortedByProperty = property;
+	lv->listview_redraw();
 }
 
-int Fle_Listview::get_sort_direction() const
+Fle_Listview::Fle_Listview(int X, int Y, int W, int H, const char* l) : Fl_Group(X, Y, W, H, l),
+m_hscrollbar(0, 0, 0, 0, 0), m_vscrollbar(0, 0, 0, 0, 0)
 {
-	if (m_state & FLE_LISTVIEW_SORTED_DESCENDING) return 0;
-	if (m_state & FLE_LISTVIEW_SORTED_ASCENDING) return 1;
+	m_displayMode = FLE_LISTVIEW_DISPLAY_DETAILS;
+	m_state = FLE_LISTVIEW_DETAILS_HIGHLIGHT | FLE_LISTVIEW_REDRAW | FLE_LISTVIEW_DND;
+	m_headersHeight = 20;
+	m_focusedItem = -1;
+	m_lastSelectedItem = -1;
+	m_itemsBBoxX = 0;
+	m_itemsBBoxY = 0;
+	m_columnWidth = 0;
+	m_gridCellW = 0;
+	m_gridCellH = 0;
+	m_gridPerLine = 0;
+	m_gridOriginY = 0;
+	m_anchorIndex = -1;
+	m_anchorOffset = 0;
+	m_anchorSaved = false;
+	m_anchorHorizontal = false;
+	m_anchorItem = nullptr;
+	m_iconRangeFirst = 0;
+	m_iconRangeLast = -1;
+	m_callbackItem = nullptr;
+	m_iconLoader = nullptr;
+	m_exporter = nullptr;
+	m_dndFormat = FLE_LISTVIEW_DND_NONE;
+	m_postedItems.store(nullptr);
+	m_postScheduled.store(false);
+	m_postBatchSize = 1000;
+	m_scrollPending = 0;
+	m_scrollVelocity = 0;
+	m_scrollFrameRate = 60;
+	m_keyFocusPending = -1;
+	m_keyExtendPending = false;
+	m_pinnedColumns = 0;
+	m_pinnedStrip = 0;
+	m_pinnedStripW = 0;
+	m_pinnedStripH = 0;
+	m_pinnedStripScrollY = 0;
+	m_pinnedStripValid = false;
+	m_drawingPinned = false;
+	m_itemDrawOffsetX = 0;
+	m_itemDrawOffsetY = 0;
+	m_headerCache = 0;
+	m_headerDragSnapshot = nullptr;
+	m_rowIndex = new Fle_Row_Index();
+	m_childrenCallback = nullptr;
+	m_childrenCallbackData = nullptr;
+	m_layoutGeneration = 0;
+	m_labelWidthsValid = false;
+	m_labelWidthsFont = -1;
+	m_labelWidthsSize = -1;
+	m_labelEditor = nullptr;
+	m_editedItem = nullptr;
+	m_editedIndex = -1;
+	m_nameDisplayText = "Name";
+	m_nameHeaderMinWidth = 100;
+	m_sortedByProperty = -2;
+	m_margin = 5;
+	m_headersColor = FL_BACKGROUND_COLOR;
+	m_hscrollbar.type(FL_HORIZONTAL);
+	m_hscrollbar.when(FL_WHEN_CHANGED);
+	m_vscrollbar.when(FL_WHEN_CHANGED);
+	m_hscrollbar.callback(scr_callback, (void*)1);
+	m_vscrollbar.callback(scr_callback, (void*)0);
+	set_property_order({});
+	set_property_widths({});
+	set_display_mode(FLE_LISTVIEW_DISPLAY_DETAILS);
 
-	return -1;
-}
+	end();
+	when(FL_WHEN_CHANGED);
 
-int Fle_Listview::get_sorted_by_property() const
-{
-	return m_sortedByProperty;
-}
+	box(FL_DOWN_BOX);
+	color(FL_BACKGROUND2_COLOR);
 
-void Fle_Listview::draw_background()
-{
-	fl_draw_box(box(), x(), y(), w(), h(), color());
+	// Items may be constructed on producer threads, see post_item()
+	Fle_Listview_Item::create_default_icons();
+
+	s_listviews.push_back(this);
 }
 
-void Fle_Listview::draw()
+Fle_Listview::~Fle_Listview()
 {
-	if(m_state & FLE_LISTVIEW_INDICES_INVALIDATED)
+	s_listviews.erase(std::find(s_listviews.begin(), s_listviews.end(), this));
+	if (s_dndSource == this) s_dndSource = nullptr;
+	m_editedItem = nullptr;
+	Fl::remove_timeout(post_timeout_cb, this);
+	Fl::remove_timeout(scroll_timeout_cb, this);
+	Fl::remove_timeout(tooltip_timeout_cb, this);
+	Fl::remove_timeout(key_timeout_cb, this);
+	Fl::remove_timeout(export_timeout_cb, this);
+	Fle_Frame_Scheduler::cancel(this);
+	if (m_pinnedStrip) fl_delete_offscreen(m_pinnedStrip);
+	if (m_headerCache) fl_delete_offscreen(m_headerCache);
+	delete m_headerDragSnapshot;
+
+	Fle_Listview_Item* posted = m_postedItems.exchange(nullptr);
+	while (posted)
 	{
-		set_focused(-1);
-		deselect_all();
-		m_lastSelectedItem = -1;
-		m_state &= ~FLE_LISTVIEW_INDICES_INVALIDATED;
+		Fle_Listview_Item* next = posted->m_postNext;
+		delete posted;
+		posted = next;
+	}
+	for (int i = 0; i < m_postBacklog.size(); i++)
+	{
+		delete m_postBacklog[i];
 	}
-	Fle_Listview_Display_Mode mode = get_display_mode();
 
-	draw_background();
+	delete m_exporter;
+	delete m_iconLoader;
+	delete m_rowIndex;
+	clear_icon_cache();
+}
 
-	if (m_state & FLE_LISTVIEW_NEEDS_ARRANGING)
-		arrange_items();
+void Fle_Listview::arrange_items()
+{
+	if (w() == 0 || h() == 0) return;
+
+	FLE_INSTRUMENT_SCOPE("Fle_Listview::arrange_items");
+	FLE_INSTRUMENT_COUNT("Fle_Listview::arrange_items items", m_items.size());
+
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+
+	Fle_Listview_Display_Mode mode = get_display_mode();
+	bool grouped = rows_grouped();
+	int group = 0;
+
+	int X = 0;
+	int Y = (mode == FLE_LISTVIEW_DISPLAY_DETAILS ? m_headersHeight : 0);
+	int W = 0;
+	int H = 0;
 
+	// Row offsets are needed to know if the vertical scrollbar will be shown
 	if (mode == FLE_LISTVIEW_DISPLAY_DETAILS)
 	{
-		// Draw header
-		int prevWidth = 0;
-		int bdw = Fl::box_dw(box());
+		m_rowIndex->build(m_items);
+		if (grouped) update_group_offsets();
+	}
+
+	recalc_item_column_width();
+	int widest = m_columnWidth;
+	int columnSum = 0;
 
-		int scrollbar = 0;
-		// At this point in time the scrollbar may or may not be visible
-		// need to check if it WILL be visible
-		if (m_items.size() * 20 >= y() + h()) scrollbar = Fl::scrollbar_size();
+	m_itemsBBoxX = 0;
+	m_itemsBBoxY = 0;
 
-		fl_font(labelfont(), labelsize());
+	// Record the grid, so that item ranges can be found without iterating the items
+	int availableW = w() - Fl::scrollbar_size() - (2 * m_margin);
+	int availableH = h() - Fl::scrollbar_size() - (2 * m_margin);
+	m_gridOriginY = Y;
+	m_gridPerLine = 1;
+	m_iconRangeFirst = 0;
+	m_iconRangeLast = -1;
 
-		for (int i = 0; i < m_propertyOrder.size(); i++)
-		{
-			int prop = m_propertyOrder[i];
-			int propWidth = m_propertyHeaderWidths[prop];
+	switch (mode)
+	{
+	case FLE_LISTVIEW_DISPLAY_ICONS:
+		m_gridCellW = 76;
+		m_gridCellH = 76;
+		break;
+	case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
+	case FLE_LISTVIEW_DISPLAY_LIST:
+		m_gridCellW = widest;
+		m_gridCellH = 20;
+		break;
+	case FLE_LISTVIEW_DISPLAY_DETAILS:
+		m_gridCellW = m_columnEdges[0];
+		m_gridCellH = 20;
+		break;
+	case FLE_LISTVIEW_DISPLAY_TOOLBOX:
+		m_gridCellW = 32;
+		m_gridCellH = 32;
+		break;
+	default:
+		// Unknown layout, ranges span all items
+		m_gridPerLine = 0;
+		break;
+	}
 
-			fl_draw_box(FL_UP_BOX, x() + w() - prevWidth - propWidth - scrollbar - bdw, y(), propWidth + (i == 0 ? bdw + scrollbar: 0), m_headersHeight, m_headersColor);
-			fl_color(labelcolor());
-			fl_draw(m_propertyDisplayNames[prop].c_str(), x() + w() - prevWidth - propWidth - scrollbar - bdw + 4, y(), propWidth, m_headersHeight, FL_ALIGN_LEFT);
+	if (m_gridPerLine != 0 && m_gridCellW > 0 && mode != FLE_LISTVIEW_DISPLAY_DETAILS)
+	{
+		if (mode == FLE_LISTVIEW_DISPLAY_LIST)
+			m_gridPerLine = std::max(1, availableH / m_gridCellH);
+		else
+			m_gridPerLine = std::max(1, availableW / m_gridCellW);
+	}
 
-			if (m_sortedByProperty == prop)
-			{
-				int X = x() + w() - prevWidth - bdw - 18;
-				if (i != 0) X -= scrollbar;
+	for (int i = 0; i < m_items.size(); i++)
+	{
+		Fle_Listview_Item* item = m_items[i];
 
-				fl_draw(get_sort_direction() == 1 ? "@-38UpArrow" : "@-32DnArrow", X, y(), w() - prevWidth, m_headersHeight, FL_ALIGN_LEFT, nullptr, 1);
+		switch (mode)
+		{
+		case FLE_LISTVIEW_DISPLAY_ICONS:
+			W = 76;
+			H = 76;
+			if (X > 0 && X + W > availableW)
+			{
+				X = 0;
+				Y += 76;
+			}
+			break;
+		case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
+			H = 20;
+			W = widest;
+			if (X > 0 && X + W > availableW)
+			{
+				X = 0;
+				Y += 20;
 			}
+			break;
+		case FLE_LISTVIEW_DISPLAY_DETAILS:
+			H = item->m_rowHeight;
+			W = m_columnEdges[0];
+			if (grouped)
+			{
+				// Items follow the header row of their group, collapsed ones take no area
+				while (i >= m_groups[group].first + m_groups[group].count) group++;
 
-			prevWidth += propWidth;
+				if (i == m_groups[group].first) Y = m_gridOriginY + m_groupOffsets[group] + 20;
+				if (m_groups[group].collapsed)
+				{
+					Y = m_gridOriginY + m_groupOffsets[group];
+					W = 0;
+					H = 0;
+				}
+			}
+			break;
+		case FLE_LISTVIEW_DISPLAY_LIST:
+			W = widest;
+			H = 20;
+			if (columnSum > 0 && Y + H > availableH)
+			{
+				X += widest;
+				Y -= columnSum;
+				columnSum = 0;
+			}
+			columnSum += H;
+			break;
+		case FLE_LISTVIEW_DISPLAY_TOOLBOX:
+			W = 32;
+			H = 32;
+			if (X > 0 && X + W > availableW)
+			{
+				X = 0;
+				Y += 32;
+			}
+			break;
 		}
 
-		fl_draw_box(FL_UP_BOX, x(), y(), w() - prevWidth - scrollbar - bdw, m_headersHeight, m_headersColor);
-		fl_color(labelcolor());
-		fl_draw(m_nameDisplayText.c_str(), x() + 4, y(), w() - prevWidth, m_headersHeight, FL_ALIGN_LEFT);
+		item->resize(X, Y, W, H);
+		item->m_layoutGeneration = m_layoutGeneration;
 
-		if (m_sortedByProperty == -1)
+		if (X + W > m_itemsBBoxX) m_itemsBBoxX = X + W;
+		if (Y + H > m_itemsBBoxY) m_itemsBBoxY = Y + H;
+
+		switch (mode)
 		{
-			fl_draw(get_sort_direction() == 1 ? "@-38UpArrow" : "@-32DnArrow", x() + w() - prevWidth - scrollbar - bdw - 18, y(), w() - prevWidth, m_headersHeight, FL_ALIGN_LEFT, nullptr, 1);
+		case FLE_LISTVIEW_DISPLAY_ICONS:
+			X += 76;
+			break;
+		case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
+			X += widest;
+			break;
+		case FLE_LISTVIEW_DISPLAY_DETAILS:
+			Y += H;
+			break;
+		case FLE_LISTVIEW_DISPLAY_LIST:
+			Y += 20;
+			break;
+		case FLE_LISTVIEW_DISPLAY_TOOLBOX:
+			X += 32;
+			break;
 		}
+	}
 
-		fl_push_clip(x(), y() + m_headersHeight, w(), h() - m_headersHeight);
+	// Collapsed groups at the end still show their headers
+	if (grouped)
+	{
+		m_itemsBBoxX = std::max(m_itemsBBoxX, m_columnEdges[0]);
+		m_itemsBBoxY = std::max(m_itemsBBoxY, m_gridOriginY + m_groupOffsets.back());
+	}
+
+	m_state &= ~FLE_LISTVIEW_NEEDS_ARRANGING;
+	m_interaction.hitValid = false;
+
+	restore_anchor();
+
+	if (m_editedItem) place_label_editor();
+
+	update_scrollbars();
+
+	listview_redraw();
+}
+
+void Fle_Listview::keyboard_select(int key)
+{	
+	// A lone tree-list item can still be expanded
+	if(m_items.empty() || (m_items.size() == 1 && !tree_list())) return;
+
+	// Keys repeated faster than the frame rate move from the focus that
+	// hasn't been applied yet
+	int from = m_keyFocusPending != -1 ? m_keyFocusPending : m_focusedItem;
+	if (from == -1) from = 0;
+
+	int itemToFocus = -1;
+	int last = (int)m_items.size() - 1;
+	int perLine = std::max(1, m_gridPerLine);
+	int pageLines;
+
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST)
+	{
+		// Items run down the columns, a page is the visible columns
+		pageLines = m_gridCellW > 0 ? (w() - (2 * m_margin)) / m_gridCellW : 1;
 	}
 	else
 	{
-		fl_push_clip(x(), y(), w(), h());
+		pageLines = m_gridCellH > 0 ? (h() - m_gridOriginY - (2 * m_margin)) / m_gridCellH : 1;
 	}
+	pageLines = std::max(1, pageLines);
 
-	
-	// Draw all items
-	fl_font(labelfont(), labelsize());
-	for (int i = 0; i < m_items.size(); i++)
-		if(intersect(x(), y(), x() + w(), y() + h(), m_items[i]->x(), m_items[i]->y(), m_items[i]->x() + m_items[i]->w(), m_items[i]->y() + m_items[i]->h()))
-			m_items[i]->draw_item(i);
+	// In tree-list mode, Right expands an item or moves to it's first child,
+	// Left collapses an item or moves to it's parent
+	if (tree_list() && get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && (key == FL_Right || key == FL_Left))
+	{
+		Fle_Listview_Item* item = m_items[from];
 
+		if (key == FL_Right && item->m_expandable && !item->m_expanded)
+		{
+			expand_item(from, true);
+			return;
+		}
+		if (key == FL_Left && item->m_expanded)
+		{
+			expand_item(from, false);
+			return;
+		}
 
-	// Draw frame
-	if(box() != FL_FLAT_BOX)
-	{
-		if (mode == FLE_LISTVIEW_DISPLAY_DETAILS)
+		if (key == FL_Right && item->m_expanded && from < last && m_items[from + 1]->m_treeParent == item)
+			itemToFocus = from + 1;
+		if (key == FL_Left && item->m_treeParent)
 		{
- 			fl_draw_box(fl_frame(box()), x(), y() + m_headersHeight, w(), h() - m_headersHeight, color());
+			itemToFocus = from - 1;
+			while (itemToFocus > 0 && m_items[itemToFocus] != item->m_treeParent) itemToFocus--;
 		}
-		else
+
+		key = 0;
+	}
+
+	switch (key)
+	{
+	case FL_Home:
+		itemToFocus = 0;
+		break;
+	case FL_End:
+		itemToFocus = last;
+		break;
+	case FL_Page_Up:
+		itemToFocus = std::max(0, from - pageLines * perLine);
+		break;
+	case FL_Page_Down:
+		itemToFocus = std::min(last, from + pageLines * perLine);
+		break;
+	default:
+		switch (get_display_mode())
 		{
-			fl_draw_box(fl_frame(box()), x(), y(), w(), h(), color());
+		case FLE_LISTVIEW_DISPLAY_LIST:
+			if (key == FL_Right)
+				itemToFocus = from + perLine;
+			if (key == FL_Left)
+				itemToFocus = from - perLine;
+		case FLE_LISTVIEW_DISPLAY_DETAILS:
+			if (key == FL_Down)
+				itemToFocus = from + 1;
+			if (key == FL_Up)
+				itemToFocus = from - 1;
+			break;
+		case FLE_LISTVIEW_DISPLAY_TOOLBOX:
+		case FLE_LISTVIEW_DISPLAY_ICONS:
+		case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
+			if (key == FL_Right)
+				itemToFocus = from + 1;
+			if (key == FL_Left)
+				itemToFocus = from - 1;
+			if (key == FL_Down)
+				itemToFocus = from + perLine;
+			if (key == FL_Up)
+				itemToFocus = from - perLine;
+			break;
 		}
+		break;
 	}
 
-	// Draw focus rectangle
-	if (Fl::focus() == this && m_focusedItem != -1)
+	// Rows have their own heights in details mode, a page is the height of the viewport
+	if ((key == FL_Page_Up || key == FL_Page_Down) && get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && m_rowIndex->size() == (int)m_items.size())
 	{
-		Fle_Listview_Item *item = m_items[m_focusedItem];
-		Fl_Color c = item->is_selected() ? FL_SELECTION_COLOR : color();
-		int textX, textY, textW, textH;
-		item->get_text_xywh(textX, textY, textW, textH);
+		int pageH = h() - m_gridOriginY - (2 * m_margin);
+		int offset = get_item_offset(from) + (key == FL_Page_Down ? pageH : -pageH);
+		int atOffset = get_item_at_offset(std::max(0, std::min(offset, get_rows_height() - 1)));
 
-		draw_focus(FL_FLAT_BOX, textX, textY, textW, textH, c);
+		if (atOffset != -1) itemToFocus = atOffset;
 	}
 
-	fl_pop_clip();
+	if (itemToFocus < 0) return;
+	if (itemToFocus > last) return;
 
-	// Draw scrollbars
-	draw_children();
+	// Items of collapsed groups are skipped in the direction of the move
+	int direction = itemToFocus < from ? -1 : 1;
+	int shown = next_shown_item(itemToFocus, direction);
+	if (shown < 0 || shown > last) shown = next_shown_item(itemToFocus, -direction);
+	if (shown < 0 || shown > last) return;
+	itemToFocus = shown;
+
+	m_keyFocusPending = itemToFocus;
+	m_keyExtendPending = Fl::event_shift() && !single_selection();
+
+	// Only one focus move is applied per frame, the first one right away
+	if (!Fl::has_timeout(key_timeout_cb, this))
+		apply_keyboard_focus();
 }
 
-void Fle_Listview::add_item(Fle_Listview_Item* item)
+void Fle_Listview::key_timeout_cb(void* data)
 {
-	m_items.push_back(item);
-	item->m_listview = this;
-	item->set_display_mode(get_display_mode());
+	((Fle_Listview*)data)->apply_keyboard_focus();
+}
 
-	m_state &= ~FLE_LISTVIEW_SORTED_ASCENDING;
-	m_state &= ~FLE_LISTVIEW_SORTED_DESCENDING;
-	m_sortedByProperty = -2;
+void Fle_Listview::apply_keyboard_focus()
+{
+	int target = m_keyFocusPending;
+	m_keyFocusPending = -1;
 
-	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	if (target == -1 || target > (int)m_items.size() - 1) return;
 
-	if(when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_ADDED);
+	if (m_keyExtendPending)
+	{
+		// The range is anchored at the last item selected without Shift
+		if (m_lastSelectedItem == -1 || m_lastSelectedItem > (int)m_items.size() - 1)
+			m_lastSelectedItem = m_focusedItem != -1 ? m_focusedItem : 0;
 
-	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+		select_range(m_lastSelectedItem, target);
+	}
 
-	listview_redraw();
+	set_focused(target);
+
+	Fl::add_timeout(FLE_LISTVIEW_FRAME_TIME, key_timeout_cb, this);
 }
 
-void Fle_Listview::insert_item(Fle_Listview_Item* item, int index)
+void Fle_Listview::select_range(int from, int to)
 {
-	m_items.insert(m_items.begin() + index, item);
-	item->m_listview = this;
-	item->set_display_mode(get_display_mode());
-
-	m_state &= ~FLE_LISTVIEW_SORTED_ASCENDING;
-	m_state &= ~FLE_LISTVIEW_SORTED_DESCENDING;
-	m_sortedByProperty = -2;
+	int first = std::min(from, to);
+	int last = std::max(from, to);
 
-	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	set_redraw(false);
 
-	if (when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_ADDED);
+	// Deselect everything outside the range in a single pass
+	std::vector<int>::iterator kept = m_selected.begin();
+	for (std::vector<int>::iterator it = m_selected.begin(); it != m_selected.end(); it++)
+	{
+		if (*it >= first && *it <= last)
+		{
+			*kept++ = *it;
+			continue;
+		}
 
-	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+		Fle_Listview_Item* item = get_item(*it);
+		item->set_selected(false);
 
-	listview_redraw();
-}
+		if (when() & FL_WHEN_CHANGED)
+			do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+	}
+	m_selected.erase(kept, m_selected.end());
 
-void Fle_Listview::remove_item(Fle_Listview_Item* item)
-{
-	std::vector<Fle_Listview_Item*>::iterator it = std::find(m_items.begin(), m_items.end(), item);
-	if (it == std::prev(m_items.end()) && m_focusedItem == m_items.size() - 1)
+	if (m_selected.size() != last - first + 1)
 	{
-		set_focused(-1);
-	}
-	m_items.erase(it);
+		for (int i = first; i <= last; i++)
+		{
+			Fle_Listview_Item* item = get_item(i);
+			if (item->is_selected()) continue;
 
-	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+			item->set_selected(true);
+			m_selected.push_back(i);
 
-	if (when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_REMOVED);
+			if (when() & FL_WHEN_CHANGED)
+				do_callback_for_item(item, FLE_LISTVIEW_REASON_SELECTED);
+		}
+	}
 
-	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+	set_redraw(true);
 
 	listview_redraw();
 }
 
-void Fle_Listview::remove_item(int index)
+void Fle_Listview::get_grid_xy_at(int X, int Y, int& gridX, int& gridY)
 {
-	if(index > m_items.size() - 1) return;
-
-	Fle_Listview_Item* item = get_item(index);
-	remove_item(item);
+	gridX = 0;
+	gridY = 0;
+	
+	int scrX = m_hscrollbar.value();
+	int scrY = m_vscrollbar.value();
 
-	delete item;
-}
+	Fle_Listview_Display_Mode mode = get_display_mode();
 
-void Fle_Listview::remove_selected()
-{
-	set_redraw(false);
-	std::vector<int> selected = get_selected();
-	deselect_all();
-	std::sort(selected.begin(), selected.end(), [](int a, int b) { return a > b; });
-	set_focused(-1);
-	for (int i = 0; i < selected.size(); i++)
+	if (mode == FLE_LISTVIEW_DISPLAY_DETAILS)
 	{
-		remove_item(selected[i]);
+		// Rows have their own heights, the grid row is the item under the coordinates
+		gridY = get_item_at_offset(Y - y() - m_margin + scrY - m_gridOriginY);
 	}
-	set_redraw(true);
-	listview_redraw();
-}
-
-void Fle_Listview::clear_items()
-{
-	set_redraw(false);
-	for(Fle_Listview_Item* item : m_items)
+	else if (mode == FLE_LISTVIEW_DISPLAY_ICONS)
 	{
-		delete item;
+		gridX = (X - x() - m_margin + scrX) / 76;
+		gridY = (Y - y() - m_margin + scrY) / 76;
+	}
+	else if (mode == FLE_LISTVIEW_DISPLAY_TOOLBOX)
+	{
+		gridX = (X - x() - m_margin + scrX) / 32;
+		gridY = (Y - y() - m_margin + scrY) / 32;
+	}
+	else
+	{
+		gridX = (X - x() - m_margin + scrX) / get_item(0)->w();
+		gridY = (Y - y() - m_margin + scrY) / 20;
 	}
-	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
-	m_items.clear();
-	m_selected.clear();
-	m_vscrollbar.value(0);
-	m_hscrollbar.value(0);
-	m_focusedItem = -1;
-	set_redraw(true);
-	listview_redraw();
 }
 
-void Fle_Listview::deselect_all(int otherThan)
+void Fle_Listview::get_visible_range(int& first, int& last, int extraLines) const
 {
-	if(m_selected.size() == 0) return;
-	set_redraw(false);
-	bool otherThanSelected = false;
-	for(std::vector<int>::iterator it = m_selected.begin(); it != m_selected.end();)
-	{
-		Fle_Listview_Item* item = get_item(*it);
-		if (*it == otherThan) 
-		{
-			otherThanSelected = item->is_selected();
-			it++;
-			continue;
-		}
+	first = 0;
+	last = (int)m_items.size() - 1;
 
-		it = m_selected.erase(it);
+	if (m_items.empty() || m_gridPerLine <= 0 || m_gridCellW <= 0 || m_gridCellH <= 0) return;
 
-		item->set_selected(false);
-		if (when() & FL_WHEN_CHANGED)
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && m_rowIndex->size() == (int)m_items.size())
+	{
+		// Rows have their own heights, extra lines are counted in default row heights
+		int offset = m_vscrollbar.value() - m_margin - m_gridOriginY;
+		int top = std::max(0, offset - extraLines * m_gridCellH);
+		int bottom = offset + h() - 1 + extraLines * m_gridCellH;
+
+		if (!rows_grouped())
 		{
-			do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+			first = m_rowIndex->find(top);
+			last = std::min(m_rowIndex->find(bottom), (int)m_items.size() - 1);
+			return;
 		}
-	}
-	set_redraw(true);
-
-	listview_redraw();
-}
 
-void Fle_Listview::select_item(int index, bool selected)
-{
-	if(index > m_items.size() - 1) return;
-	Fle_Listview_Item* item = get_item(index);
+		// Only groups with their header in view have visible items. Items of
+		// collapsed groups inside the range are skipped with next_shown_item().
+		first = 0;
+		last = -1;
 
-	if (!selected && item->is_selected())
-	{
-		m_selected.erase(std::find(m_selected.begin(), m_selected.end(), index));
-		item->set_selected(false);
-		if(when() & FL_WHEN_CHANGED)
+		for (int g = get_offset_group(top); g < (int)m_groups.size() && m_groupOffsets[g] <= bottom; g++)
 		{
-			do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+			const Group& group = m_groups[g];
+			int itemsTop = m_groupOffsets[g] + 20;
+			int from = std::max(top, itemsTop);
+			int to = std::min(bottom, m_groupOffsets[g + 1] - 1);
+			if (group.collapsed || from > to) continue;
+
+			int base = m_rowIndex->prefix(group.first) - itemsTop;
+			if (last == -1) first = m_rowIndex->find(base + from);
+			last = std::min(m_rowIndex->find(base + to), group.first + group.count - 1);
 		}
-		listview_redraw();
+
 		return;
 	}
 
-	bool wasSelected = item->is_selected();
-	item->set_selected(true);
+	int firstLine, lastLine;
 
-	if (!wasSelected)
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST)
 	{
-		m_selected.push_back(index);
+		int offset = m_hscrollbar.value() - m_margin;
+		firstLine = offset / m_gridCellW;
+		lastLine = (offset + w() - 1) / m_gridCellW;
 	}
-
-	if(when() & FL_WHEN_CHANGED)
+	else
 	{
-		if (wasSelected)
-		{
-			do_callback_for_item(item, FLE_LISTVIEW_REASON_RESELECTED);
-		}
-		else
-		{
-			do_callback_for_item(item, FLE_LISTVIEW_REASON_SELECTED);
-		}
+		int offset = m_vscrollbar.value() - m_margin - m_gridOriginY;
+		firstLine = offset / m_gridCellH;
+		lastLine = (offset + h() - 1) / m_gridCellH;
 	}
-	listview_redraw();
-}
 
-void Fle_Listview::select_item(Fle_Listview_Item* item, bool selected)
-{
-	select_item(std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item)), selected);
-}
+	firstLine = std::max(0, firstLine - extraLines);
+	lastLine += extraLines;
 
-int Fle_Listview::get_item_count() const
-{
-	return m_items.size();
+	first = std::min(firstLine * m_gridPerLine, (int)m_items.size());
+	last = std::min((lastLine + 1) * m_gridPerLine - 1, (int)m_items.size() - 1);
 }
 
-int Fle_Listview::get_selected_count() const
+void Fle_Listview::save_anchor()
 {
-	return m_selected.size();
-}
+	// Only the layout before the first change since the last relayout is valid
+	if (m_anchorSaved) return;
 
-Fle_Listview_Display_Mode Fle_Listview::get_display_mode() const
-{
-	return m_displayMode;
-}
+	m_anchorSaved = true;
+	m_anchorItem = nullptr;
+	m_anchorIndex = -1;
+	m_anchorHorizontal = get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST;
 
-Fle_Listview_Item* Fle_Listview::get_item(int index) const
-{
-	return m_items[index];
-}
+	int first, last;
+	get_visible_range(first, last);
+	if (first > last) return;
 
-Fle_Listview_Item* Fle_Listview::get_item_at(int X, int Y) const
-{
-	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && Y < y() + m_headersHeight)
-		return nullptr;
+	m_anchorIndex = first;
+	if (m_focusedItem >= first && m_focusedItem <= last)
+		m_anchorIndex = m_focusedItem;
 
-	for (Fle_Listview_Item* item : m_items)
-	{
-		if(X >= item->x() && X < item->x() + item->w() && Y >= item->y() && Y < item->y() + item->h())
-		{
-			return item;
-		}
-	}
+	m_anchorItem = m_items[m_anchorIndex];
+	update_item_position(m_anchorIndex);
 
-	return nullptr;
+	if (m_anchorHorizontal)
+		m_anchorOffset = m_anchorItem->m_x - m_hscrollbar.value();
+	else
+		m_anchorOffset = m_anchorItem->m_y - m_vscrollbar.value();
 }
 
-Fle_Listview_Item* Fle_Listview::get_item_drag_at(int x, int y) const
+void Fle_Listview::restore_anchor()
 {
-	Fle_Listview_Item* item = get_item_at(x, y);
-	
-	if (item && item->is_inside_drag_area(x, y))
-		return item;
-
-	return nullptr;
-}
+	if (!m_anchorSaved) return;
 
-Fle_Listview_Item* Fle_Listview::get_callback_item() const
-{
-	return m_callbackItem;
-}
+	m_anchorSaved = false;
 
-const std::vector<int>& Fle_Listview::get_selected() const
-{
-	return m_selected;
-}
+	// The new position of the anchor item is known after the relayout. If
+	// it's gone, the item that took it's index is used.
+	Fle_Listview_Item* item = m_anchorItem;
+	m_anchorItem = nullptr;
 
-void Fle_Listview::set_display_mode(Fle_Listview_Display_Mode mode)
-{
-	if (mode == m_displayMode) return;
+	if (item == nullptr)
+	{
+		if (m_anchorIndex < 0 || m_items.empty()) return;
 
-	m_displayMode = mode;
+		item = m_items[std::min(m_anchorIndex, (int)m_items.size() - 1)];
+	}
 
-	m_vscrollbar.value(0);
-	m_hscrollbar.value(0);
+	bool horizontal = get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST;
+	int offset = horizontal == m_anchorHorizontal ? m_anchorOffset : 0;
 
-	for (int i = 0; i < m_items.size(); i++)
+	if (horizontal)
 	{
-		m_items[i]->set_display_mode(mode);
+		int scrollTo = std::min(item->m_x - offset, m_itemsBBoxX - w() + (2 * m_margin));
+		m_hscrollbar.value(std::max(0, scrollTo));
+	}
+	else
+	{
+		int scrollTo = std::min(item->m_y - offset, m_itemsBBoxY - h() + (2 * m_margin));
+		m_vscrollbar.value(std::max(0, scrollTo));
 	}
-
-	arrange_items();
-}
-
-void Fle_Listview::ensure_item_visible(int item)
-{
-	ensure_item_visible(get_item(item));
 }
 
-void Fle_Listview::ensure_item_visible(Fle_Listview_Item* item)
+void Fle_Listview::request_visible_icons()
 {
-	int scrollX = m_hscrollbar.value();
-	int scrollY = m_vscrollbar.value();
+	if (m_iconLoader == nullptr) return;
 
 	Fle_Listview_Display_Mode mode = get_display_mode();
+	int size = (mode == FLE_LISTVIEW_DISPLAY_ICONS || mode == FLE_LISTVIEW_DISPLAY_TOOLBOX) ? 32 : 16;
+	int bit = Fle_Icon_Loader::request_bit(size);
 
-	if (mode == FLE_LISTVIEW_DISPLAY_LIST)
+	// Near-visible items are the ones up to one page away from the viewport
+	int pageLines = 0;
+	if (m_gridCellW > 0 && m_gridCellH > 0)
+		pageLines = mode == FLE_LISTVIEW_DISPLAY_LIST ? w() / m_gridCellW : h() / m_gridCellH;
+
+	int first, last, nearFirst, nearLast;
+	get_visible_range(first, last);
+	get_visible_range(nearFirst, nearLast, pageLines + 1);
+
+	// Visible items are queued first
+	for (int i = next_shown_item(first, 1); i <= last; i = next_shown_item(i + 1, 1))
 	{
-		if (item->x() < x() || item->w() > w())
-		{
-			m_hscrollbar.value(scrollX - (x() - item->x() + m_margin));
-		}
-		else if(item->x() + item->w() > x() + w())
-		{
-			m_hscrollbar.value(scrollX - (x() + w() - item->x() - item->w() + m_margin));
-		}
+		if (!(m_items[i]->m_iconRequests & bit))
+			m_iconLoader->request(m_items[i], size);
 	}
-	else
+	for (int i = next_shown_item(nearFirst, 1); i <= nearLast; i = next_shown_item(i + 1, 1))
 	{
-		if (item->y() < y() + (mode == FLE_LISTVIEW_DISPLAY_DETAILS ? m_headersHeight : 0) || item->h() > h())
-		{
-			m_vscrollbar.value(scrollY - (y() + (mode == FLE_LISTVIEW_DISPLAY_DETAILS ? m_headersHeight : 0) - item->y()));
-		}
-		else if (item->y() + item->h() > y() + h())
-		{
-			m_vscrollbar.value(scrollY - (y() + h() - item->y() - item->h()));
-		}
+		if (!(m_items[i]->m_iconRequests & bit))
+			m_iconLoader->request(m_items[i], size);
 	}
 
-	listview_redraw();
-}
-
-void Fle_Listview::set_redraw(bool redraw)
-{
-	if (redraw)
+	if (nearFirst != m_iconRangeFirst || nearLast != m_iconRangeLast)
 	{
-		m_state |= FLE_LISTVIEW_REDRAW;
-	}
-	else
-		m_state &= ~FLE_LISTVIEW_REDRAW;
+		m_iconRangeFirst = nearFirst;
+		m_iconRangeLast = nearLast;
+
+		std::vector<Fle_Listview_Item*> wanted;
+		for (int i = next_shown_item(nearFirst, 1); i <= nearLast; i = next_shown_item(i + 1, 1))
+			wanted.push_back(m_items[i]);
+		std::sort(wanted.begin(), wanted.end());
 
+		m_iconLoader->retain(wanted);
+	}
 }
 
-int Fle_Listview::handle(int e)
+void Fle_Listview::drag_select(int x1, int y1, int x2, int y2)
 {
-	if (e == FL_ENTER || e == FL_LEAVE) return 1;
+	FLE_INSTRUMENT_SCOPE("Fle_Listview::drag_select");
+	FLE_INSTRUMENT_COUNT("Fle_Listview::drag_select items", m_items.size());
 
-	int ret = Fl_Group::handle(e);
-
-	static int dragX, dragY;
-	static int resizingHeaderProperty = -2;
-	static int lastGridX, lastGridY;
-	static bool itemDrag = false;
-	static Fle_Listview_Item* lastAtItem = nullptr;
+	if(!Fl::event_ctrl())
+		m_selected.clear();
 
-	int ex = Fl::event_x();
-	int ey = Fl::event_y();
-	int gridX, gridY;
-	Fle_Listview_Item* atItem = get_item_at(ex, ey);
-	
-	if(item_tooltips() && lastAtItem != atItem)
+	for (int i = 0; i < m_items.size(); i++)
 	{
-		Fl_Tooltip::enter(nullptr);
-		if(atItem)
+		Fle_Listview_Item* item = get_item(i);
+		update_item_position(i);
+
+		// Items of collapsed groups take no area
+		if(item->h() > 0 && intersect(x1, y1, x2, y2, item->x(), item->y(), item->x() + item->w(), item->y() + item->h()))
 		{
-			copy_tooltip(atItem->get_tooltip().c_str());
+			if (item->is_selected())
+			{
+				m_selected.push_back(i);
+				
+				// reselect callback
+				if (when() & FL_WHEN_CHANGED)
+					do_callback_for_item(item, FLE_LISTVIEW_REASON_RESELECTED);
+			}
+			else
+			{
+				item->set_selected(true);
+				m_selected.push_back(i);
+
+				if (when() & FL_WHEN_CHANGED)
+					do_callback_for_item(item, FLE_LISTVIEW_REASON_SELECTED);
+			}
 		}
-		else
+		else if (item->is_selected() && !Fl::event_ctrl())
 		{
-			copy_tooltip("");
+			item->set_selected(false);
+			if (when() & FL_WHEN_CHANGED)
+				do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
 		}
-		Fl_Tooltip::enter(this);
 	}
+}
 
-	if (dnd())
+void Fle_Listview::update_scrollbars()
+{
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST)
 	{
-		if (e == FL_DND_ENTER || e == FL_DND_DRAG || e == FL_DND_RELEASE)
-			return 1;
-
-		if(e == FL_PASTE)
+		m_vscrollbar.hide();
+		if (m_itemsBBoxX + m_hscrollbar.value() > w() || m_hscrollbar.value() != 0)
 		{
-			if (when() & FL_WHEN_CHANGED)
-			{
-				do_callback((Fl_Callback_Reason)FLE_LISTVIEW_REASON_DND_END);
-			}
-			return 1;
+			m_hscrollbar.show();
+			m_hscrollbar.resize(x() + Fl::box_dx(box()), y() + h() - Fl::scrollbar_size() - Fl::box_dy(box()), w() - Fl::box_dw(box()), Fl::scrollbar_size());
+			m_hscrollbar.value(m_hscrollbar.value(), w(), 0, m_itemsBBoxX + (2 * m_margin));
 		}
+		else
+			m_hscrollbar.hide();
 	}
-	if (e == FL_PUSH)
+	else if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS)
 	{
-		if(Fl::focus() != this)
+		// Columns wider than the viewport scroll horizontally
+		bool horizontal = m_itemsBBoxX + (2 * m_margin) > w() || m_hscrollbar.value() != 0;
+		int hscrollbarH = horizontal ? Fl::scrollbar_size() : 0;
+		int vscrollbarW = 0;
+
+		if (m_itemsBBoxY > h() - m_headersHeight - hscrollbarH + m_vscrollbar.value() || m_vscrollbar.value() != 0)
 		{
-			Fl::focus(this);
+			vscrollbarW = Fl::scrollbar_size();
+			m_vscrollbar.show();
+			m_vscrollbar.resize(x() + w() - Fl::scrollbar_size() - Fl::box_dx(box()), y() + Fl::box_dy(box()) + m_headersHeight, Fl::scrollbar_size(), h() - Fl::box_dh(box()) - m_headersHeight - hscrollbarH);
+			m_vscrollbar.value(m_vscrollbar.value(), h() - m_headersHeight - hscrollbarH, 0, m_itemsBBoxY - m_headersHeight + (2 * m_margin));
 		}
-		if (atItem)
+		else
+			m_vscrollbar.hide();
+
+		if (horizontal)
 		{
-			if (dnd() && atItem->is_inside_drag_area(ex, ey) && atItem->is_selected() && !Fl::event_ctrl())
-			{
-				itemDrag = true;
-			}
-			bool selected = true;
-			if (atItem->is_selected() && Fl::event_ctrl()) selected = false;
-			handle_user_selection(atItem, selected, true, itemDrag);
+			m_hscrollbar.show();
+			m_hscrollbar.resize(x() + Fl::box_dx(box()), y() + h() - Fl::scrollbar_size() - Fl::box_dy(box()), w() - Fl::box_dw(box()) - vscrollbarW, Fl::scrollbar_size());
+			m_hscrollbar.value(m_hscrollbar.value(), w() - vscrollbarW, 0, m_itemsBBoxX + (2 * m_margin));
 		}
-		else if (ret != 1 && m_displayMode != FLE_LISTVIEW_DISPLAY_TOOLBOX) // Always keep one tool selected
+		else
+			m_hscrollbar.hide();
+	}
+	else
+	{
+		m_hscrollbar.hide();
+		if (m_itemsBBoxY > h() + m_vscrollbar.value() || m_vscrollbar.value() != 0)
 		{
-			// Clear selection
-			deselect_all();
+			m_vscrollbar.show();
+			m_vscrollbar.resize(x() + w() - Fl::scrollbar_size() - Fl::box_dx(box()), y() + Fl::box_dy(box()), Fl::scrollbar_size(), h() - Fl::box_dh(box()));
+			m_vscrollbar.value(m_vscrollbar.value(), h(), 0, m_itemsBBoxY + (2 * m_margin));
 		}
+		else
+			m_vscrollbar.hide();
+	}
+}
 
-		// Resize header bars by dragging
-		resizingHeaderProperty = -2;
-		if (ex > x() && ex < x() + w() && ey > y() && ey <= y() + m_headersHeight)
+void Fle_Listview::recalc_item_column_width()
+{
+	switch (get_display_mode())
+	{
+	default:
+		m_columnWidth = 0;
+		break;
+	case FLE_LISTVIEW_DISPLAY_DETAILS:
+		m_columnWidth = layout_columns(-2, 0, m_columnEdges);
+		break;
+	case FLE_LISTVIEW_DISPLAY_SMALL_ICONS:
+	case FLE_LISTVIEW_DISPLAY_LIST:
+	{
+		// Labels are measured again when entering these modes or when the font
+		// changes, otherwise the widths are kept up to date as items are added,
+		// removed and renamed
+		bool fontChanged = m_labelWidthsFont != labelfont() || m_labelWidthsSize != labelsize();
+		if (!m_labelWidthsValid || fontChanged)
 		{
-			int prevWidth = 0;
-			int bdw = Fl::box_dw(box());
-
-			int scrollbar = 0;
-
-			if (m_vscrollbar.visible()) scrollbar = Fl::scrollbar_size();
+			m_labelWidths.clear();
+			m_labelWidthsFont = labelfont();
+			m_labelWidthsSize = labelsize();
+			m_labelWidthsValid = true;
 
-			for (int i = 0; i < m_propertyOrder.size(); i++)
+			// Items may have been renamed while the widths weren't kept
+			for (int i = 0; i < m_items.size(); i++)
 			{
-				int prop = m_propertyOrder[i];
-				int propWidth = m_propertyHeaderWidths[prop];
-
-				if (Fl::event_inside(x() + w() - prevWidth - propWidth - scrollbar - bdw - 4, y(), 6, m_headersHeight))
-				{
-					resizingHeaderProperty = prop;
-					window()->cursor(FL_CURSOR_WE);
-					break;
-				}
-
-				prevWidth += propWidth;
+				m_items[i]->m_labelWidth = -1;
+				m_labelWidths.insert(get_cached_label_width(m_items[i]));
 			}
 		}
 
-		// Selection box
-		dragX = ex;
-		dragY = ey;
-
-		get_grid_xy_at(ex, ey, gridX, gridY);
+		m_columnWidth = m_labelWidths.empty() ? 0 : *m_labelWidths.rbegin() + 16;
 
-		return 1;
+		if (m_columnWidth > 200) m_columnWidth = 200;
+		break;
 	}
-	else if (e == FL_MOUSEWHEEL)
-	{
-		if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST && m_hscrollbar.visible())
-		{
-			int scrollTo = m_hscrollbar.value() + Fl::event_dy() * 10;
-			if(scrollTo < 0) scrollTo = 0;
-			if(scrollTo > m_itemsBBoxX - w() + (2 * m_margin)) scrollTo = m_itemsBBoxX - w() + (2 * m_margin);
+	}
+}
 
-			m_hscrollbar.value(scrollTo);
-		}
-		else if(m_vscrollbar.visible())
-		{
-			int scrollTo = m_vscrollbar.value() + Fl::event_dy() * 5;
-			if(scrollTo < 0) scrollTo = 0;
-			if(scrollTo > m_itemsBBoxY - h() + (2 * m_margin)) scrollTo = m_itemsBBoxY - h() + (2 * m_margin);
+void Fle_Listview::set_focused(Fle_Listview_Item* item, bool focused)
+{
+	set_focused(std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item)));
+}
 
-			m_vscrollbar.value(scrollTo);
-		}
-		listview_redraw();
-		return 1;
-	}
-	else if (e == FL_DRAG)
-	{
-		int scrollTo = 0;
-		get_grid_xy_at(ex, ey, gridX, gridY);
+void Fle_Listview::set_focused(int item)
+{
+	// Check for bounds and if already focused
+	if (item == m_focusedItem || item > m_items.size() - 1) return;
+	// Unfocus current
+	if (m_focusedItem != -1) m_items[m_focusedItem]->set_focus(false);
 
-		if(get_display_mode() != FLE_LISTVIEW_DISPLAY_DETAILS)
-		{
-			if (ex > x() + w())
-			{
-				scrollTo = m_hscrollbar.value() + 3;
-				if (scrollTo <= m_itemsBBoxX - w())
-				{
-					m_hscrollbar.value(scrollTo);
-					dragX -= 3;
-					update_scrollbars();
-					listview_redraw();
-				}
-			}
-			if (ex < x())
-			{
-				scrollTo = m_hscrollbar.value() - 3;
-				if (scrollTo >= 0)
-				{
-					m_hscrollbar.value(scrollTo);
-					dragX += 3;
-					update_scrollbars();
-					listview_redraw();
-				}
-			}
-		}
-		else if(resizingHeaderProperty != -2)
-		{
-			// Resize property header
-			int diff = dragX - ex;
+	// Focus selected
+	m_focusedItem = item;
 
-			int newval = m_propertyHeaderWidths[resizingHeaderProperty] + diff;
+	if(m_focusedItem == -1)
+	{
+		listview_redraw();
+		return;
+	}
 
-			int nameHeaderWidth = w();
-			nameHeaderWidth -= newval;
+	Fle_Listview_Item* i = m_items[item];
+	i->set_focus(true);
 
-			for (int i = 0; i < m_propertyOrder.size(); i++)
-			{
-				if (m_propertyOrder[i] != resizingHeaderProperty)
-				{
-					nameHeaderWidth -= m_propertyHeaderWidths[m_propertyOrder[i]];
-				}
-			}
+	ensure_item_visible(i);
+}
 
-			if(nameHeaderWidth >= m_nameHeaderMinWidth && newval > m_propertyHeaderMinWidths[resizingHeaderProperty])
-			{
-				m_propertyHeaderWidths[resizingHeaderProperty] += diff;
+void Fle_Listview::handle_user_selection(Fle_Listview_Item* item, bool selected, bool scrollTo, bool keepSelected)
+{
+	bool ctrl = Fl::event_ctrl();
+	bool shift = Fl::event_shift();
+	int index = std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item));
 
-				dragX = ex;
-				dragY = ey;
+	if (!keepSelected && (single_selection() || (!ctrl && !shift)))
+	{
+		deselect_all(selected ? index : -1);
+	}
 
-				recalc_item_column_width();
-				listview_redraw();
+	if(shift && m_lastSelectedItem == -1) m_lastSelectedItem = 0;
 
-				return 1;
-			}
-		}
-		if (ey > y() + h())
-		{
-			scrollTo = m_vscrollbar.value() + 3;
-			if (scrollTo <= m_itemsBBoxY -h())
-			{
-				m_vscrollbar.value(scrollTo);
-				dragY -= 3;
-				update_scrollbars();
-				listview_redraw();
-			}
-		}
-		if (ey < y())
+	if (shift && !single_selection())
+	{
+		for (std::vector<int>::iterator it = m_selected.begin(); it != m_selected.end();)
 		{
-			scrollTo = m_vscrollbar.value() - 3;
-			if (scrollTo >= 0)
+			if (*it >= std::min(m_lastSelectedItem, index + 1) && *it <= std::max(m_lastSelectedItem, index))
 			{
-				m_vscrollbar.value(scrollTo);
-				dragY += 3;
-				update_scrollbars();
-				listview_redraw();
+				// Keep this selected
+				it++;
+				continue;
 			}
-		}
-
-		if (resizingHeaderProperty == -2 && !single_selection() && (std::abs(dragX - ex) >= 6 || std::abs(dragY - ey) >= 6))
-		{
-			if(gridX != lastGridX || gridY != lastGridY)
-			{
-				if (itemDrag)
-				{
-					// Start drag of selected items
-					if (when() & FL_WHEN_CHANGED)
-					{
-						do_callback((Fl_Callback_Reason)FLE_LISTVIEW_REASON_DND_START);
-						Fl::dnd();
 
-						return 1;
-					}
-				}
-				else
-				{
-					drag_select(dragX, dragY, ex, ey);
-					window()->make_current();
-					listview_redraw();
-					lastGridX = gridX;
-					lastGridY = gridY;
-				}
-			}
+			Fle_Listview_Item* item = get_item(*it);
+			item->set_selected(false);
 
-			window()->make_current();
-			fl_overlay_rect(dragX, dragY, ex - dragX, ey - dragY);
+			if (when() & FL_WHEN_CHANGED)
+				do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
 
-			return 1;
+			it = m_selected.erase(it);
+			if(it == m_selected.end()) break;
 		}
-	}
-	else if (e == FL_RELEASE)
-	{
-		window()->make_current();
-		fl_overlay_clear();
-
-		if (itemDrag)
+		// "Bridge" from the last selected to currently selected
+		for (int i = std::min(m_lastSelectedItem, index); i <= std::max(m_lastSelectedItem, index); i++)
 		{
-			deselect_all(m_lastSelectedItem);
+			select_item(i, true);
 		}
-		itemDrag = false;
+	}
+	else
+	{
+		select_item(index, selected);
+		m_lastSelectedItem = index;
+	}
 
-		// Check for clicks on headers
-		if (resizingHeaderProperty == -2 && get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS)
-		{
-			if (ex > x() && ex < x() + w() && ey > y() && ey <= y() + m_headersHeight)
-			{
-				int prevWidth = 0;
-				int bdw = Fl::box_dw(box());
+	if(scrollTo)
+		set_focused(index);
+	
+	listview_redraw();
+}
 
-				int scrollbar = 0;
+void Fle_Listview::set_details_mode(int mode)
+{
+	int oldState = m_state;
+	
+	m_state &= ~FLE_LISTVIEW_DETAILS_NONE;
+	m_state &= ~FLE_LISTVIEW_DETAILS_LINES;
+	m_state &= ~FLE_LISTVIEW_DETAILS_HIGHLIGHT;
 
-				if (m_vscrollbar.visible()) scrollbar = Fl::scrollbar_size();
+	m_state |= mode;
 
-				for (int i = 0; i < m_propertyOrder.size(); i++)
-				{
-					int prop = m_propertyOrder[i];
-					int propWidth = m_propertyHeaderWidths[prop];
+	if (oldState != m_state) listview_redraw();
+}
 
-					if (Fl::event_inside(x() + w() - prevWidth - propWidth - scrollbar - bdw, y(), propWidth + (i == 0 ? bdw + scrollbar : 0), m_headersHeight))
-					{
-						// Clicked on a property
-						if (m_sortedByProperty == prop)
-						{
-							sort_items(m_state & FLE_LISTVIEW_SORTED_DESCENDING, prop);
-						}
-						else
-							sort_items(true, prop);
-						return 1;
-					}
+int Fle_Listview::get_details_mode() const
+{
+	return m_state & FLE_LISTVIEW_DETAILS_NONE ? 0 : m_state & FLE_LISTVIEW_DETAILS_LINES ? 1 : 2;
+}
 
-					prevWidth += propWidth;
-				}
-				// Clicked on the name, not any other added properties
-				if (m_sortedByProperty == -1)
-				{
-					sort_items(m_state & FLE_LISTVIEW_SORTED_DESCENDING, -1);
-				}
-				else
-					sort_items(true, -1);
-				return 1;
-			}
-		}
-		if (resizingHeaderProperty != -2)
-		{
-			window()->cursor(FL_CURSOR_DEFAULT);
-			resizingHeaderProperty = -2;
+void Fle_Listview::set_headers_color(Fl_Color c)
+{
+	m_headersColor = c;
+	invalidate_header_cache();
+}
 
-			return 1;
-		}
+void Fle_Listview::single_selection(bool s)
+{
+	if (s)
+	{
+		m_state |= FLE_LISTVIEW_SINGLE_SELECTION;
 	}
-	else if (e == FL_FOCUS)
+	else
+		m_state &= ~FLE_LISTVIEW_SINGLE_SELECTION;
+}
+
+void Fle_Listview::add_property_name(std::string name)
+{
+	m_propertyDisplayNames.push_back(std::move(name));
+	invalidate_header_cache();
+}
+
+void Fle_Listview::set_property_order(std::vector<int> order)
+{
+	m_propertyOrder = std::move(order);
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	listview_redraw();
+}
+
+const std::vector<int>& Fle_Listview::get_property_order() const
+{
+	return m_propertyOrder;
+}
+
+void Fle_Listview::set_property_widths(std::vector<int> widths)
+{
+	m_propertyHeaderMinWidths = widths;
+	m_propertyHeaderWidths = std::move(widths);
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	listview_redraw();
+}
+
+void Fle_Listview::set_name_min_width(int width)
+{
+	m_nameHeaderMinWidth = width;
+}
+
+int Fle_Listview::get_property_header_width(int property) const
+{
+	return m_propertyHeaderWidths[property];
+}
+
+int Fle_Listview::layout_columns(int property, int width, std::vector<int>& edges) const
+{
+	int propertiesWidth = 0;
+	for (int i = 0; i < m_propertyOrder.size(); i++)
 	{
-		if(m_items.size() > 0 && m_focusedItem == -1)
+		propertiesWidth += m_propertyOrder[i] == property ? width : get_property_header_width(m_propertyOrder[i]);
+	}
+
+	// At this point in time the scrollbar may or may not be visible
+	// need to check if it WILL be visible
+	int W = w() - (2 * m_margin);
+	if (get_rows_height() >= h()) W -= Fl::scrollbar_size();
+
+	// The name column takes the space the properties leave, but never
+	// less than it's minimum. Columns that don't fit are scrolled to.
+	int nameWidth = std::max(m_nameHeaderMinWidth, W - propertiesWidth);
+
+	// Properties are laid out right to left, starting at the right edge
+	int edge = nameWidth + propertiesWidth;
+	edges.resize(m_propertyOrder.size() + 1);
+	for (int i = 0; i < m_propertyOrder.size(); i++)
+	{
+		edges[i] = edge;
+		edge -= m_propertyOrder[i] == property ? width : get_property_header_width(m_propertyOrder[i]);
+	}
+	edges[m_propertyOrder.size()] = edge;
+
+	return nameWidth;
+}
+
+void Fle_Listview::get_visible_properties(int& first, int& last) const
+{
+	get_visible_properties(m_columnEdges, first, last);
+}
+
+void Fle_Listview::get_visible_properties(const std::vector<int>& edges, int& first, int& last) const
+{
+	first = 0;
+	last = -1;
+
+	int count = (int)m_propertyOrder.size();
+	if (count == 0 || edges.size() != count + 1) return;
+
+	int left = m_hscrollbar.value() - m_margin;
+	int right = left + w();
+	int pinned = std::min(std::max(m_pinnedColumns - 1, 0), count);
+
+	if (m_drawingPinned)
+	{
+		first = count - pinned;
+		last = count - 1;
+		return;
+	}
+
+	// Scrolled columns are hidden behind the pinned ones
+	if (m_pinnedColumns > 0)
+	{
+		left += get_pinned_width(edges);
+		count -= pinned;
+	}
+
+	// The edges decrease from the rightmost column to the name column. Column
+	// i spans from edge i + 1 to edge i.
+	std::vector<int>::const_iterator begin = edges.begin();
+	int startsBeforeRight = std::upper_bound(begin + 1, edges.end(), right, std::greater<int>()) - begin;
+	int endsAfterLeft = std::lower_bound(begin, edges.end(), left, std::greater<int>()) - begin;
+
+	first = startsBeforeRight - 1;
+	last = std::min(endsAfterLeft - 1, count - 1);
+}
+
+int Fle_Listview::get_property_x(int index) const
+{
+	return m_columnEdges[index + 1];
+}
+
+int Fle_Listview::get_header_property_at(int X, bool edge) const
+{
+	int count = (int)m_propertyOrder.size();
+	if (m_columnEdges.size() != count + 1) return -2;
+
+	int contentX = X - x() - m_margin;
+	if (X >= x() + get_pinned_width()) contentX += m_hscrollbar.value();
+
+	// First edge left of the coordinate, the column right of it is the one under it
+	int i = std::lower_bound(m_columnEdges.begin(), m_columnEdges.end(), contentX, std::greater<int>()) - m_columnEdges.begin();
+
+	if (edge)
+	{
+		// Resize handles span from 4 pixels left to 2 pixels right of the
+		// left edge of every property column
+		if (i >= 1 && i <= count && contentX - m_columnEdges[i] < 2) return m_propertyOrder[i - 1];
+		if (i >= 2 && i - 1 <= count && m_columnEdges[i - 1] - contentX <= 4) return m_propertyOrder[i - 2];
+
+		return -2;
+	}
+
+	if (i > count) return -1;
+	// The rightmost header extends to the right edge of the listview
+	if (i == 0) return count > 0 ? m_propertyOrder[0] : -1;
+
+	return m_propertyOrder[i - 1];
+}
+
+void Fle_Listview::set_margin(int m)
+{
+	m_margin = m;
+
+	update_scrollbars();
+	listview_redraw();
+}
+
+int Fle_Listview::get_margin() const
+{
+	return m_margin;
+}
+
+int Fle_Listview::get_item_column_width() const
+{
+	return m_columnWidth;
+}
+
+Fl_Image* Fle_Listview::get_cached_icon(Fl_Pixmap* icon)
+{
+	if (icon == nullptr) return nullptr;
+
+	std::map<Fl_Pixmap*, Fl_RGB_Image*>::iterator it = m_iconCache.find(icon);
+	if (it == m_iconCache.end())
+	{
+		Fl_RGB_Image* rgb = new Fl_RGB_Image(icon, color());
+		if (rgb->fail())
 		{
-			set_focused(0);
+			delete rgb;
+			rgb = nullptr;
 		}
-		return 1;
+
+		it = m_iconCache.insert(std::make_pair(icon, rgb)).first;
 	}
-	else if(e == FL_UNFOCUS)
+
+	if (it->second == nullptr) return icon;
+
+	return it->second;
+}
+
+void Fle_Listview::clear_icon_cache()
+{
+	for (std::map<Fl_Pixmap*, Fl_RGB_Image*>::iterator it = m_iconCache.begin(); it != m_iconCache.end(); it++)
 	{
-		redraw();
-		return 1;
+		delete it->second;
 	}
-	else if (e == FL_KEYDOWN && Fl::focus() == this)
+	m_iconCache.clear();
+}
+
+void Fle_Listview::set_icon_provider(Fle_Listview_Icon_Provider* provider, int threads)
+{
+	delete m_iconLoader;
+	m_iconLoader = nullptr;
+	m_iconRangeFirst = 0;
+	m_iconRangeLast = -1;
+
+	for (int i = 0; i < m_items.size(); i++)
 	{
-		switch (Fl::event_key())
+		Fle_Listview_Item* item = m_items[i];
+		delete item->m_loadedSmallIcon;
+		delete item->m_loadedBigIcon;
+		item->m_loadedSmallIcon = nullptr;
+		item->m_loadedBigIcon = nullptr;
+		item->m_iconRequests = 0;
+	}
+
+	if (provider != nullptr)
+		m_iconLoader = new Fle_Icon_Loader(this, provider, threads);
+
+	listview_redraw();
+}
+
+Fle_Listview_Icon_Provider* Fle_Listview::get_icon_provider() const
+{
+	return m_iconLoader ? m_iconLoader->m_provider : nullptr;
+}
+
+void Fle_Listview::set_name_text(std::string t)
+{
+	m_nameDisplayText = std::move(t);
+	invalidate_header_cache();
+}
+
+bool Fle_Listview::single_selection() const
+{
+	return m_state & FLE_LISTVIEW_SINGLE_SELECTION;
+}
+
+void Fle_Listview::dnd(bool dnd)
+{
+	if(dnd)
+	{
+		m_state |= FLE_LISTVIEW_DND;
+	}
+	else
+		m_state &= ~FLE_LISTVIEW_DND;
+}
+
+void Fle_Listview::set_dnd_format(Fle_Listview_Dnd_Format format)
+{
+	m_dndFormat = format;
+}
+
+Fle_Listview_Dnd_Format Fle_Listview::get_dnd_format() const
+{
+	return m_dndFormat;
+}
+
+Fle_Listview* Fle_Listview::get_dnd_source()
+{
+	return s_dndSource;
+}
+
+void Fle_Listview::copy_dnd_payload()
+{
+	// Clearing keeps the capacity, so large drags allocate only the first time
+	m_dndPayload.clear();
+
+	const char* lineBreak = m_dndFormat == FLE_LISTVIEW_DND_URI_LIST ? "\r\n" : "\n";
+
+	// Items are serialised in index order rather than selection order
+	std::vector<std::pair<int, int>> ranges;
+	get_selected_ranges(ranges);
+
+	for (int r = 0; r < ranges.size(); r++)
+	{
+		for (int i = ranges[r].first; i <= ranges[r].second; i++)
 		{
-		case FL_Up:
-		case FL_Down:
-		case FL_Right:
-		case FL_Left:
-			keyboard_select(Fl::event_key());
-			return 1;
-			break;
-		case ' ':
-			if(m_focusedItem != -1)
-				handle_user_selection(m_items[m_focusedItem], true, true, false);
-			break;
-		case 'a':
-			if (Fl::event_ctrl() && !single_selection())
-			{
-				for (int i = 0; i < m_items.size(); i++)
-				{
-					select_item(i, true);
-				}
-			}
-			break;
+			size_t size = m_dndPayload.size();
+			if (size > 0) m_dndPayload += lineBreak;
+			size_t itemStart = m_dndPayload.size();
+			m_items[i]->append_dnd_data(m_dndPayload, m_dndFormat);
+
+			// Items that append nothing don't get a line either
+			if (m_dndPayload.size() == itemStart) m_dndPayload.resize(size);
 		}
 	}
 
-	lastAtItem = atItem;
+	Fl::copy(m_dndPayload.c_str(), (int)m_dndPayload.size(), 0);
+}
 
-	return ret;
+void Fle_Listview::item_tooltips(bool tooltips)
+{
+	if(tooltips)
+	{
+		m_state |= FLE_LISTVIEW_ITEM_TOOLTIPS;
+
+		copy_tooltip("FLEET!!!");
+	}
+	else
+		m_state &= ~FLE_LISTVIEW_ITEM_TOOLTIPS;
 }
 
-void Fle_Listview::resize(int X, int Y, int W, int H)
+void Fle_Listview::smooth_scrolling(bool smooth)
 {
+	if(smooth)
+	{
+		m_state |= FLE_LISTVIEW_SMOOTH_SCROLLING;
+	}
+	else
+		m_state &= ~FLE_LISTVIEW_SMOOTH_SCROLLING;
+}
+
+void Fle_Listview::kinetic_scrolling(bool kinetic)
+{
+	if(kinetic)
+	{
+		m_state |= FLE_LISTVIEW_KINETIC_SCROLLING;
+	}
+	else
+		m_state &= ~FLE_LISTVIEW_KINETIC_SCROLLING;
+}
+
+void Fle_Listview::set_scroll_frame_rate(int fps)
+{
+	m_scrollFrameRate = std::max(1, fps);
+}
+
+int Fle_Listview::get_scroll_frame_rate() const
+{
+	return m_scrollFrameRate;
+}
+
+bool Fle_Listview::scroll_by(int pixels)
+{
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST && m_hscrollbar.visible())
+	{
+		int scrollTo = m_hscrollbar.value() + pixels;
+		if(scrollTo > m_itemsBBoxX - w() + (2 * m_margin)) scrollTo = m_itemsBBoxX - w() + (2 * m_margin);
+		if(scrollTo < 0) scrollTo = 0;
+
+		if (scrollTo == m_hscrollbar.value()) return false;
+		m_hscrollbar.value(scrollTo);
+	}
+	else if(m_vscrollbar.visible())
+	{
+		int scrollTo = m_vscrollbar.value() + pixels;
+		if(scrollTo > m_itemsBBoxY - h() + (2 * m_margin)) scrollTo = m_itemsBBoxY - h() + (2 * m_margin);
+		if(scrollTo < 0) scrollTo = 0;
+
+		if (scrollTo == m_vscrollbar.value()) return false;
+		m_vscrollbar.value(scrollTo);
+	}
+	else
+		return false;
+
+	listview_redraw();
+	return true;
+}
+
+void Fle_Listview::scroll_timeout_cb(void* data)
+{
+	((Fle_Listview*)data)->scroll_frame();
+}
+
+void Fle_Listview::scroll_frame()
+{
+	double step = m_scrollPending;
+
+	// Ease out, covering about a third of the remaining distance per frame
+	if (smooth_scrolling() && std::fabs(m_scrollPending) > 3)
+		step = m_scrollPending * 0.35;
+
+	if (kinetic_scrolling())
+	{
+		if (std::fabs(step) >= 1)
+		{
+			m_scrollVelocity = step;
+		}
+		else
+		{
+			step += m_scrollVelocity;
+			m_scrollVelocity *= 0.9;
+			if (std::fabs(m_scrollVelocity) < 1) m_scrollVelocity = 0;
+		}
+	}
+
+	int pixels = (int)std::lround(step);
+	m_scrollPending -= std::min(std::fabs(m_scrollPending), std::fabs((double)pixels)) * (m_scrollPending < 0 ? -1 : 1);
+
+	if (pixels == 0 || !scroll_by(pixels))
+	{
+		// Nothing was scrolled during this frame, the next wheel event is
+		// applied immediately
+		m_scrollPending = 0;
+		m_scrollVelocity = 0;
+		return;
+	}
+
+	Fl::add_timeout(1.0 / m_scrollFrameRate, scroll_timeout_cb, this);
+}
+
+void Fle_Listview::stop_scroll_animation()
+{
+	Fl::remove_timeout(scroll_timeout_cb, this);
+	m_scrollPending = 0;
+	m_scrollVelocity = 0;
+}
+
+void Fle_Listview::do_callback_for_item(Fle_Listview_Item* item, Fle_Listview_Reason reason)
+{
+	m_callbackItem = item;
+	do_callback((Fl_Callback_Reason)reason);
+}
+
+void Fle_Listview::listview_redraw()
+{
+	// Bursts of changes request a single redraw before the next frame
+	if(m_state & FLE_LISTVIEW_REDRAW) Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_PAINT);
+}
+
+void Fle_Listview::frame_cb(void* data, int work)
+{
+	Fle_Listview* lv = (Fle_Listview*)data;
+
+	lv->redraw();
+}
+
+void Fle_Listview::sort_items(bool ascending, int property)
+{
+	FLE_INSTRUMENT_SCOPE("Fle_Listview::sort_items");
+	FLE_INSTRUMENT_COUNT("Fle_Listview::sort_items items", m_items.size());
+
+	save_anchor();
+
+	// Remove focus and selections
+	set_focused(-1);
+
+	m_lastSelectedItem = -1;
+
+	deselect_all();
+
+	std::function<bool(Fle_Listview_Item*, Fle_Listview_Item*)> order = [property, ascending](Fle_Listview_Item* a, Fle_Listview_Item* b) { return ascending ? b->is_greater(a, property) : a->is_greater(b, property); };
+
+	if (tree_list())
+	{
+		// Siblings are sorted among themselves, then the visible rows are flattened again
+		std::vector<Fle_Listview_Item*> roots;
+		for (int i = 0; i < m_items.size(); i++)
+		{
+			if (m_items[i]->m_treeParent == nullptr) roots.push_back(m_items[i]);
+		}
+		std::sort(roots.begin(), roots.end(), order);
+
+		m_items.clear();
+		for (int i = 0; i < roots.size(); i++)
+		{
+			sort_subtree(roots[i], order);
+			append_tree_rows(m_items, roots[i]);
+		}
+	}
+	else
+	{
+		std::sort(m_items.begin(), m_items.end(), order);
+	}
+
+	// Regrouping keeps the order of the items, so each group ends up sorted
+	if (grouped_rows()) m_state |= FLE_LISTVIEW_NEEDS_GROUPING;
+
+	arrange_items();
+
+	m_state |= ascending ? FLE_LISTVIEW_SORTED_ASCENDING : FLE_LISTVIEW_SORTED_DESCENDING;
+	m_state &= ascending ? ~FLE_LISTVIEW_SORTED_DESCENDING : ~FLE_LISTVIEW_SORTED_ASCENDING;
+	m_sortedByProperty = property;
+}
+
+int Fle_Listview::get_sort_direction() const
+{
+	if (m_state & FLE_LISTVIEW_SORTED_DESCENDING) return 0;
+	if (m_state & FLE_LISTVIEW_SORTED_ASCENDING) return 1;
+
+	return -1;
+}
+
+int Fle_Listview::get_sorted_by_property() const
+{
+	return m_sortedByProperty;
+}
+
+void Fle_Listview::draw_background()
+{
+	fl_draw_box(box(), x(), y(), w(), h(), color());
+}
+
+void Fle_Listview::draw()
+{
+	FLE_INSTRUMENT_SCOPE("Fle_Listview::draw");
+
+	if(m_state & FLE_LISTVIEW_INDICES_INVALIDATED)
+	{
+		set_focused(-1);
+		deselect_all();
+		m_lastSelectedItem = -1;
+		m_state &= ~FLE_LISTVIEW_INDICES_INVALIDATED;
+	}
+	Fle_Listview_Display_Mode mode = get_display_mode();
+
+	draw_background();
+
+	if (m_state & FLE_LISTVIEW_NEEDS_ARRANGING)
+		arrange_items();
+
+	if (m_interaction.headerDragging && m_headerDragSnapshot)
+	{
+		draw_header_drag();
+		return;
+	}
+	if (m_interaction.resizingHeaderProperty >= 0 && m_headerDragSnapshot)
+	{
+		draw_header_resize();
+		return;
+	}
+
+	if (mode == FLE_LISTVIEW_DISPLAY_DETAILS)
+	{
+		draw_cached_header();
+
+		fl_push_clip(x(), y() + m_headersHeight, w(), h() - m_headersHeight);
+	}
+	else
+	{
+		fl_push_clip(x(), y(), w(), h());
+	}
+
+	
+	// Draw visible items
+	int first, last;
+	get_visible_range(first, last);
+
+	int pinnedW = mode == FLE_LISTVIEW_DISPLAY_DETAILS ? get_pinned_width() : 0;
+	if (pinnedW > 0) fl_push_clip(x() + pinnedW, y() + m_headersHeight, w() - pinnedW, h() - m_headersHeight);
+
+	fl_font(labelfont(), labelsize());
+	int drawnItems = 0;
+	for (int i = next_shown_item(first, 1); i <= last; i = next_shown_item(i + 1, 1))
+	{
+		update_item_position(i);
+
+		// Rows outside the damaged region of an update are skipped
+		if(intersect(x(), y(), x() + w(), y() + h(), m_items[i]->x(), m_items[i]->y(), m_items[i]->x() + m_items[i]->w(), m_items[i]->y() + m_items[i]->h())
+			&& fl_not_clipped(m_items[i]->x(), m_items[i]->y(), m_items[i]->w(), m_items[i]->h()))
+		{
+			m_items[i]->draw_item(i);
+			drawnItems++;
+		}
+	}
+	FLE_INSTRUMENT_COUNT("Fle_Listview::draw items", drawnItems);
+
+	if (pinnedW > 0)
+	{
+		fl_pop_clip();
+		draw_pinned_strip(first, last);
+	}
+
+	if (rows_grouped()) draw_group_headers();
+
+	request_visible_icons();
+
+
+	// Draw frame
+	if(box() != FL_FLAT_BOX)
+	{
+		if (mode == FLE_LISTVIEW_DISPLAY_DETAILS)
+		{
+ 			fl_draw_box(fl_frame(box()), x(), y() + m_headersHeight, w(), h() - m_headersHeight, color());
+		}
+		else
+		{
+			fl_draw_box(fl_frame(box()), x(), y(), w(), h(), color());
+		}
+	}
+
+	// Draw focus rectangle
+	if (Fl::focus() == this && m_focusedItem != -1) update_item_position(m_focusedItem);
+	if (Fl::focus() == this && m_focusedItem != -1 && m_items[m_focusedItem]->h() > 0)
+	{
+		Fle_Listview_Item *item = m_items[m_focusedItem];
+		Fl_Color c = item->is_selected() ? FL_SELECTION_COLOR : color();
+		int textX, textY, textW, textH;
+		item->get_text_xywh(textX, textY, textW, textH);
+
+		draw_focus(FL_FLAT_BOX, textX, textY, textW, textH, c);
+	}
+
+	fl_pop_clip();
+
+	// Draw scrollbars
+	draw_children();
+}
+
+void Fle_Listview::draw_header(int X, int Y)
+{
+	draw_header(X, Y, m_columnEdges, m_columnWidth);
+}
+
+void Fle_Listview::draw_header(int X, int Y, const std::vector<int>& edges, int nameWidth)
+{
+	// Draw header, only the columns that are scrolled into view
+	int pinnedW = get_pinned_width(edges);
+	int count = (int)m_propertyOrder.size();
+	int first, last;
+	get_visible_properties(edges, first, last);
+
+	fl_font(labelfont(), labelsize());
+
+	fl_push_clip(X + pinnedW, Y, w() - pinnedW, m_headersHeight);
+	draw_header_columns(X, Y, X + m_margin - m_hscrollbar.value(), first, last, pinnedW == 0, edges, nameWidth);
+	fl_pop_clip();
+
+	if (pinnedW > 0)
+	{
+		fl_push_clip(X, Y, pinnedW, m_headersHeight);
+		draw_header_columns(X, Y, X + m_margin, count - std::min(m_pinnedColumns, count + 1) + 1, count - 1, true, edges, nameWidth);
+		fl_pop_clip();
+	}
+}
+
+void Fle_Listview::draw_header_columns(int X, int Y, int left, int first, int last, bool name, const std::vector<int>& edges, int nameWidth)
+{
+	int count = (int)m_propertyOrder.size();
+
+	for (int i = first; i <= last; i++)
+	{
+		int prop = m_propertyOrder[i];
+		int propX = left + edges[i + 1];
+		int propWidth = edges[i] - edges[i + 1];
+		int labelW = propWidth;
+
+		// The rightmost header extends over the vertical scrollbar
+		if (i == 0) propWidth = std::max(propWidth, X + w() - propX);
+
+		fl_draw_box(FL_UP_BOX, propX, Y, propWidth, m_headersHeight, m_headersColor);
+		fl_color(labelcolor());
+		fl_draw(m_propertyDisplayNames[prop].c_str(), propX + 4, Y, labelW, m_headersHeight, FL_ALIGN_LEFT);
+
+		if (m_sortedByProperty == prop)
+		{
+			fl_draw(get_sort_direction() == 1 ? "@-38UpArrow" : "@-32DnArrow", propX + propWidth - 18, Y, 18, m_headersHeight, FL_ALIGN_LEFT, nullptr, 1);
+		}
+	}
+
+	if (!name) return;
+
+	int nameRight = left + edges[count];
+	if (count == 0) nameRight = X + w();
+
+	if (nameRight > X)
+	{
+		fl_draw_box(FL_UP_BOX, X, Y, nameRight - X, m_headersHeight, m_headersColor);
+		fl_color(labelcolor());
+		fl_draw(m_nameDisplayText.c_str(), left - m_margin + 4, Y, nameWidth, m_headersHeight, FL_ALIGN_LEFT);
+
+		if (m_sortedByProperty == -1)
+		{
+			fl_draw(get_sort_direction() == 1 ? "@-38UpArrow" : "@-32DnArrow", nameRight - 18, Y, 18, m_headersHeight, FL_ALIGN_LEFT, nullptr, 1);
+		}
+	}
+}
+
+void Fle_Listview::begin_header_drag()
+{
+	Interaction& state = m_interaction;
+
+	// The columns are moved as pixels during the drag, without drawing the
+	// items or their properties again
+	delete m_headerDragSnapshot;
+	m_headerDragSnapshot = fl_capture_window(window(), x(), y(), w(), h());
+	if (!m_headerDragSnapshot) return;
+
+	get_visible_properties(state.headerDragFirst, state.headerDragLast);
+	if (state.headerDragIndex < state.headerDragFirst || state.headerDragIndex > state.headerDragLast)
+	{
+		delete m_headerDragSnapshot;
+		m_headerDragSnapshot = nullptr;
+		return;
+	}
+
+	state.headerDragLeft = x() + m_margin - m_hscrollbar.value();
+	state.headerDragging = true;
+}
+
+int Fle_Listview::get_header_drag_target() const
+{
+	const Interaction& state = m_interaction;
+
+	// Visible columns run from headerDragLast on the left to headerDragFirst
+	// on the right. The dragged column goes before the first one whose
+	// center is right of the ghost's center.
+	int dragged = state.headerDragIndex;
+	int ghostCenter = state.headerDragX - state.headerDragGrabX + (m_columnEdges[dragged] - m_columnEdges[dragged + 1]) / 2;
+	int X = state.headerDragLeft + m_columnEdges[state.headerDragLast + 1];
+	int slot = 0;
+
+	for (int i = state.headerDragLast; i >= state.headerDragFirst; i--)
+	{
+		if (i == dragged) continue;
+
+		int width = m_columnEdges[i] - m_columnEdges[i + 1];
+		if (ghostCenter < X + width / 2) break;
+
+		X += width;
+		slot++;
+	}
+
+	return slot;
+}
+
+void Fle_Listview::draw_header_drag()
+{
+	const Interaction& state = m_interaction;
+	Fl_RGB_Image* snapshot = m_headerDragSnapshot;
+
+	int pinnedW = get_pinned_width();
+	int vscrollbarW = m_vscrollbar.visible() ? Fl::scrollbar_size() : 0;
+	int stripH = h() - (m_hscrollbar.visible() ? Fl::scrollbar_size() : 0) - Fl::box_dy(box());
+
+	snapshot->draw(x(), y(), w(), h(), 0, 0);
+
+	// Lay out the visible columns again in the order they would have after
+	// a release, copying each from the snapshot
+	int dragged = state.headerDragIndex;
+	int draggedW = m_columnEdges[dragged] - m_columnEdges[dragged + 1];
+	int draggedSrcX = state.headerDragLeft + m_columnEdges[dragged + 1] - x();
+	int target = get_header_drag_target();
+	int X = state.headerDragLeft + m_columnEdges[state.headerDragLast + 1];
+	int targetX = -1;
+	int slot = 0;
+
+	fl_push_clip(x() + pinnedW, y(), w() - pinnedW - vscrollbarW, stripH);
+
+	for (int i = state.headerDragLast; i >= state.headerDragFirst; i--)
+	{
+		if (i == dragged) continue;
+
+		if (slot == target)
+		{
+			targetX = X;
+			snapshot->draw(X, y(), draggedW, stripH, draggedSrcX, 0);
+			X += draggedW;
+		}
+
+		int width = m_columnEdges[i] - m_columnEdges[i + 1];
+		snapshot->draw(X, y(), width, stripH, state.headerDragLeft + m_columnEdges[i + 1] - x(), 0);
+		X += width;
+		slot++;
+	}
+
+	if (targetX == -1)
+	{
+		targetX = X;
+		snapshot->draw(X, y(), draggedW, stripH, draggedSrcX, 0);
+	}
+
+	// Insertion mark and the floating header
+	fl_color(FL_SELECTION_COLOR);
+	fl_rectf(targetX - 1, y(), 2, stripH);
+
+	snapshot->draw(state.headerDragX - state.headerDragGrabX, y(), draggedW, m_headersHeight, draggedSrcX, 0);
+	fl_color(FL_FOREGROUND_COLOR);
+	fl_rect(state.headerDragX - state.headerDragGrabX, y(), draggedW, m_headersHeight);
+
+	fl_pop_clip();
+}
+
+void Fle_Listview::draw_header_resize()
+{
+	int prop = m_interaction.resizingHeaderProperty;
+	int count = (int)m_propertyOrder.size();
+	int index = (int)(std::find(m_propertyOrder.begin(), m_propertyOrder.end(), prop) - m_propertyOrder.begin());
+	int stripH = h() - (m_hscrollbar.visible() ? Fl::scrollbar_size() : 0) - Fl::box_dy(box());
+
+	m_headerDragSnapshot->draw(x(), y(), w(), h(), 0, 0);
+
+	// Preview the header with the new width, the rows stay as captured
+	std::vector<int> edges;
+	int nameWidth = layout_columns(prop, m_interaction.resizeWidth, edges);
+
+	fl_push_clip(x(), y(), w(), m_headersHeight);
+	draw_header(x(), y(), edges, nameWidth);
+	fl_pop_clip();
+
+	int edgeX = x() + m_margin + edges[index + 1];
+	if (index < count - std::max(m_pinnedColumns - 1, 0)) edgeX -= m_hscrollbar.value();
+
+	fl_push_clip(x(), y() + m_headersHeight, w(), stripH - m_headersHeight);
+	fl_color(FL_FOREGROUND_COLOR);
+	fl_line_style(FL_DOT);
+	fl_yxline(edgeX, y() + m_headersHeight, y() + stripH);
+	fl_line_style(0);
+	fl_pop_clip();
+}
+
+void Fle_Listview::end_header_drag()
+{
+	Interaction& state = m_interaction;
+
+	int target = get_header_drag_target();
+	int dragged = state.headerDragIndex;
+	int draggedProperty = m_propertyOrder[dragged];
+
+	// Visible column right of which the dragged one ends up, -1 if it ends up
+	// leftmost among the visible ones
+	int before = -1;
+	int slot = 0;
+	for (int i = state.headerDragLast; i >= state.headerDragFirst && slot < target; i--)
+	{
+		if (i == dragged) continue;
+
+		before = m_propertyOrder[i];
+		slot++;
+	}
+
+	delete m_headerDragSnapshot;
+	m_headerDragSnapshot = nullptr;
+	state.headerDragging = false;
+	state.headerDragIndex = -1;
+
+	// The order runs right to left, so being right of a column means a lower index
+	std::vector<int> order = m_propertyOrder;
+	order.erase(order.begin() + dragged);
+
+	if (before == -1)
+	{
+		int leftmost = m_propertyOrder[state.headerDragLast];
+		if (leftmost == draggedProperty)
+		{
+			listview_redraw();
+			return;
+		}
+		order.insert(std::find(order.begin(), order.end(), leftmost) + 1, draggedProperty);
+	}
+	else
+	{
+		order.insert(std::find(order.begin(), order.end(), before), draggedProperty);
+	}
+
+	set_property_order(order);
+}
+
+void Fle_Listview::draw_cached_header()
+{
+	if (w() <= 0 || m_headersHeight <= 0) return;
+
+	// Everything the header band looks like depends on
+	std::vector<int> key;
+	key.reserve(16 + (2 * m_propertyOrder.size()));
+	key.push_back(w());
+	key.push_back(m_headersHeight);
+	key.push_back(m_hscrollbar.value());
+	key.push_back(m_margin);
+	key.push_back(m_pinnedColumns);
+	key.push_back(m_sortedByProperty);
+	key.push_back(get_sort_direction());
+	key.push_back(m_columnWidth);
+	key.push_back((int)Fl::get_color(m_headersColor));
+	key.push_back((int)Fl::get_color(labelcolor()));
+	key.push_back(labelfont());
+	key.push_back(labelsize());
+	key.insert(key.end(), m_columnEdges.begin(), m_columnEdges.end());
+	key.insert(key.end(), m_propertyOrder.begin(), m_propertyOrder.end());
+
+	// Fleet's schemes are all gleam to FLTK, they only swap box types
+	std::string scheme = Fl::scheme() ? Fl::scheme() : "";
+	scheme += "/";
+	scheme += fle_get_scheme();
+
+	if (m_headerCache && key == m_headerCacheKey && m_headerCacheScheme == scheme)
+	{
+		fl_copy_offscreen(x(), y(), w(), m_headersHeight, m_headerCache, 0, 0);
+		return;
+	}
+
+	if (m_headerCache && (m_headerCacheKey[0] != w() || m_headerCacheKey[1] != m_headersHeight))
+	{
+		fl_delete_offscreen(m_headerCache);
+		m_headerCache = 0;
+	}
+
+	if (!m_headerCache) m_headerCache = fl_create_offscreen(w(), m_headersHeight);
+
+	fl_begin_offscreen(m_headerCache);
+	draw_header(0, 0);
+	fl_end_offscreen();
+
+	m_headerCacheKey.swap(key);
+	m_headerCacheScheme = scheme;
+
+	fl_copy_offscreen(x(), y(), w(), m_headersHeight, m_headerCache, 0, 0);
+}
+
+void Fle_Listview::invalidate_header_cache()
+{
+	m_headerCacheKey.clear();
+}
+
+void Fle_Listview::draw_pinned_strip(int first, int last)
+{
+	int stripW = std::min(get_pinned_width(), w());
+	int stripH = h() - m_headersHeight;
+	if (stripW <= 0 || stripH <= 0) return;
+
+	// The strip only survives draws caused by horizontal scrolling alone,
+	// the scrollbars redrawing themselves aside
+	bool scrolledOnly = (damage() & FLE_LISTVIEW_DAMAGE_SCROLLED) && !(damage() & ~(FLE_LISTVIEW_DAMAGE_SCROLLED | FL_DAMAGE_CHILD));
+	if (!scrolledOnly || m_pinnedStripScrollY != m_vscrollbar.value()) m_pinnedStripValid = false;
+
+	if (m_pinnedStrip && (m_pinnedStripW != stripW || m_pinnedStripH != stripH))
+	{
+		fl_delete_offscreen(m_pinnedStrip);
+		m_pinnedStrip = 0;
+	}
+
+	if (!m_pinnedStrip)
+	{
+		m_pinnedStrip = fl_create_offscreen(stripW, stripH);
+		m_pinnedStripW = stripW;
+		m_pinnedStripH = stripH;
+		m_pinnedStripValid = false;
+	}
+
+	if (!m_pinnedStripValid)
+	{
+		// Draw the pinned columns unscrolled, relative to the strip
+		fl_begin_offscreen(m_pinnedStrip);
+		m_drawingPinned = true;
+		m_itemDrawOffsetX = m_hscrollbar.value() - x();
+		m_itemDrawOffsetY = -(y() + m_headersHeight);
+
+		fl_color(color());
+		fl_rectf(0, 0, stripW, stripH);
+
+		fl_font(labelfont(), labelsize());
+		for (int i = next_shown_item(first, 1); i <= last; i = next_shown_item(i + 1, 1))
+			m_items[i]->draw_item(i);
+
+		m_itemDrawOffsetX = 0;
+		m_itemDrawOffsetY = 0;
+		m_drawingPinned = false;
+		fl_end_offscreen();
+
+		m_pinnedStripValid = true;
+		m_pinnedStripScrollY = m_vscrollbar.value();
+	}
+
+	fl_copy_offscreen(x(), y() + m_headersHeight, stripW, stripH, m_pinnedStrip, 0, 0);
+}
+
+int Fle_Listview::get_pinned_width() const
+{
+	return get_pinned_width(m_columnEdges);
+}
+
+int Fle_Listview::get_pinned_width(const std::vector<int>& edges) const
+{
+	int count = (int)m_propertyOrder.size();
+	if (m_pinnedColumns <= 0 || edges.size() != count + 1) return 0;
+
+	return m_margin + edges[count - std::min(m_pinnedColumns, count + 1) + 1];
+}
+
+void Fle_Listview::set_pinned_columns(int columns)
+{
+	m_pinnedColumns = std::max(0, columns);
+	m_pinnedStripValid = false;
+
+	listview_redraw();
+}
+
+int Fle_Listview::get_pinned_columns() const
+{
+	return m_pinnedColumns;
+}
+
+void Fle_Listview::append_item(Fle_Listview_Item* item)
+{
+	save_anchor();
+
+	m_items.push_back(item);
+	item->m_listview = this;
+	item->m_labelWidth = -1;
+	item->set_display_mode(get_display_mode());
+	track_label_width(item);
+
+	m_state &= ~FLE_LISTVIEW_SORTED_ASCENDING;
+	m_state &= ~FLE_LISTVIEW_SORTED_DESCENDING;
+	m_sortedByProperty = -2;
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	if (grouped_rows()) m_state |= FLE_LISTVIEW_NEEDS_GROUPING;
+
+	if(when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_ADDED);
+}
+
+void Fle_Listview::add_item(Fle_Listview_Item* item)
+{
+	append_item(item);
+
+	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+
+	listview_redraw();
+}
+
+void Fle_Listview::post_item(Fle_Listview_Item* item)
+{
+	item->m_postNext = m_postedItems.load(std::memory_order_relaxed);
+	while (!m_postedItems.compare_exchange_weak(item->m_postNext, item));
+
+	// Only the first item posted since the last drain wakes up the FLTK thread
+	if (!m_postScheduled.exchange(true))
+	{
+		if (Fl::awake(post_awake_cb, this) != 0)
+			m_postScheduled.store(false);
+	}
+}
+
+void Fle_Listview::set_post_batch_size(int items)
+{
+	m_postBatchSize = std::max(1, items);
+}
+
+int Fle_Listview::get_post_batch_size() const
+{
+	return m_postBatchSize;
+}
+
+void Fle_Listview::post_awake_cb(void* data)
+{
+	Fle_Listview* lv = (Fle_Listview*)data;
+
+	if (std::find(s_listviews.begin(), s_listviews.end(), lv) == s_listviews.end()) return;
+
+	lv->drain_posted_items();
+}
+
+void Fle_Listview::post_timeout_cb(void* data)
+{
+	((Fle_Listview*)data)->drain_posted_items();
+}
+
+void Fle_Listview::drain_posted_items()
+{
+	// The stack holds the newest item first
+	std::vector<Fle_Listview_Item*> taken;
+	Fle_Listview_Item* posted = m_postedItems.exchange(nullptr);
+	while (posted)
+	{
+		taken.push_back(posted);
+		posted = posted->m_postNext;
+	}
+	for (int i = (int)taken.size() - 1; i >= 0; i--)
+	{
+		taken[i]->m_postNext = nullptr;
+		m_postBacklog.push_back(taken[i]);
+	}
+
+	int count = std::min((int)m_postBacklog.size(), m_postBatchSize);
+	if (count > 0)
+	{
+		// Appending doesn't shift any stored indices, and the relayout
+		// happens once, in the next draw()
+		set_redraw(false);
+		for (int i = 0; i < count; i++)
+		{
+			append_item(m_postBacklog.front());
+			m_postBacklog.pop_front();
+		}
+		set_redraw(true);
+		listview_redraw();
+	}
+
+	if (!m_postBacklog.empty())
+	{
+		if (!Fl::has_timeout(post_timeout_cb, this))
+			Fl::add_timeout(FLE_LISTVIEW_FRAME_TIME, post_timeout_cb, this);
+		return;
+	}
+
+	m_postScheduled.store(false);
+
+	// Items posted after the exchange above didn't wake up the FLTK thread
+	if (m_postedItems.load() != nullptr && !m_postScheduled.exchange(true))
+		Fl::add_timeout(FLE_LISTVIEW_FRAME_TIME, post_timeout_cb, this);
+}
+
+void Fle_Listview::insert_item(Fle_Listview_Item* item, int index)
+{
+	save_anchor();
+
+	m_items.insert(m_items.begin() + index, item);
+	item->m_listview = this;
+	item->m_labelWidth = -1;
+	item->set_display_mode(get_display_mode());
+	track_label_width(item);
+
+	m_state &= ~FLE_LISTVIEW_SORTED_ASCENDING;
+	m_state &= ~FLE_LISTVIEW_SORTED_DESCENDING;
+	m_sortedByProperty = -2;
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	if (grouped_rows()) m_state |= FLE_LISTVIEW_NEEDS_GROUPING;
+
+	if (when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_ADDED);
+
+	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+
+	listview_redraw();
+}
+
+void Fle_Listview::remove_item(Fle_Listview_Item* item)
+{
+	// The child of a collapsed tree-list item has no row, it only leaves it's parent
+	std::vector<Fle_Listview_Item*>::iterator row = std::find(m_items.begin(), m_items.end(), item);
+	if (row == m_items.end())
+	{
+		if (item->m_treeParent)
+		{
+			std::vector<Fle_Listview_Item*>& siblings = item->m_treeParent->m_children;
+			siblings.erase(std::find(siblings.begin(), siblings.end(), item));
+			item->m_treeParent = nullptr;
+			if (m_iconLoader) m_iconLoader->cancel(item);
+		}
+		return;
+	}
+
+	save_anchor();
+	cancel_export();
+
+	// A tree-list item takes it's visible descendants along, and leaves it's parent
+	if (item->m_expanded)
+	{
+		int index = (int)(row - m_items.begin());
+		int end = index + 1;
+		while (end < (int)m_items.size() && m_items[end]->m_treeDepth > item->m_treeDepth) end++;
+
+		remove_rows(index + 1, end - index - 1);
+	}
+	if (item->m_treeParent)
+	{
+		std::vector<Fle_Listview_Item*>& siblings = item->m_treeParent->m_children;
+		siblings.erase(std::find(siblings.begin(), siblings.end(), item));
+		item->m_treeParent = nullptr;
+	}
+
+	std::vector<Fle_Listview_Item*>::iterator it = std::find(m_items.begin(), m_items.end(), item);
+	if (it == std::prev(m_items.end()) && m_focusedItem == m_items.size() - 1)
+	{
+		set_focused(-1);
+	}
+	m_items.erase(it);
+	untrack_label_width(item);
+
+	if (item == m_anchorItem) m_anchorItem = nullptr;
+	if (item == m_editedItem) end_label_edit(false);
+	m_interaction.forget_item(item);
+	m_keyFocusPending = -1;
+
+	if (m_iconLoader) m_iconLoader->cancel(item);
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	if (grouped_rows()) m_state |= FLE_LISTVIEW_NEEDS_GROUPING;
+
+	if (when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_REMOVED);
+
+	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+
+	listview_redraw();
+}
+
+void Fle_Listview::remove_item(int index)
+{
+	if(index > m_items.size() - 1) return;
+
+	Fle_Listview_Item* item = get_item(index);
+	remove_item(item);
+
+	delete item;
+}
+
+void Fle_Listview::remove_selected()
+{
+	set_redraw(false);
+	std::vector<int> selected = get_selected();
+	deselect_all();
+	std::sort(selected.begin(), selected.end(), [](int a, int b) { return a > b; });
+	set_focused(-1);
+	for (int i = 0; i < selected.size(); i++)
+	{
+		remove_item(selected[i]);
+	}
+	set_redraw(true);
+	listview_redraw();
+}
+
+void Fle_Listview::clear_items()
+{
+	set_redraw(false);
+	// Repopulating the listview restores the viewport by index
+	save_anchor();
+	m_anchorItem = nullptr;
+	end_label_edit(false);
+	m_interaction.reset();
+	m_keyFocusPending = -1;
+	cancel_export();
+	if (m_iconLoader) m_iconLoader->cancel_all();
+	for(Fle_Listview_Item* item : m_items)
+	{
+		// Child items are deleted by their parents
+		if (item->m_treeParent == nullptr) delete item;
+	}
+	m_state |= FLE_LISTVIEW_INDICES_INVALIDATED;
+	m_items.clear();
+	m_selected.clear();
+	m_labelWidths.clear();
+	m_groups.clear();
+	m_groupOffsets.clear();
+	m_vscrollbar.value(0);
+	m_hscrollbar.value(0);
+	m_focusedItem = -1;
+	set_redraw(true);
+	listview_redraw();
+}
+
+bool Fle_Listview::export_items(const char* path, Fle_Listview_Export_Format format, Fle_Listview_Export_Rows rows, Fle_Listview_Export_Callback* cb, void* data)
+{
+	cancel_export();
+
+	FILE* file = fopen(path, "wb");
+	if (!file) return false;
+
+	m_exporter = new Fle_Listview_Exporter(file, format, cb, data);
+
+	// Rows are taken in their current order, which later sorting doesn't change
+	std::vector<Fle_Listview_Item*>& exported = m_exporter->m_rows;
+	if (rows == FLE_LISTVIEW_EXPORT_SHOWN)
+	{
+		for (int i = next_shown_item(0, 1); i < (int)m_items.size(); i = next_shown_item(i + 1, 1))
+			exported.push_back(m_items[i]);
+	}
+	else
+	{
+		exported.reserve(rows == FLE_LISTVIEW_EXPORT_SELECTED ? m_selected.size() : m_items.size());
+		for (int i = 0; i < m_items.size(); i++)
+		{
+			if (rows == FLE_LISTVIEW_EXPORT_ALL || m_items[i]->is_selected())
+				exported.push_back(m_items[i]);
+		}
+	}
+
+	// Columns go left to right as in details mode, property order index 0 is the rightmost
+	m_exporter->m_headers.push_back(m_nameDisplayText);
+	for (int i = (int)m_propertyOrder.size() - 1; i >= 0; i--)
+	{
+		m_exporter->m_properties.push_back(m_propertyOrder[i]);
+		m_exporter->m_headers.push_back(m_propertyDisplayNames[m_propertyOrder[i]]);
+	}
+
+	m_exporter->start();
+
+	Fl::add_timeout(0.0, export_timeout_cb, this);
+
+	return true;
+}
+
+void Fle_Listview::cancel_export()
+{
+	if (!m_exporter) return;
+
+	Fl::remove_timeout(export_timeout_cb, this);
+
+	Fle_Listview_Export_Callback* cb = m_exporter->m_callback;
+	void* data = m_exporter->m_callbackData;
+	int written = m_exporter->m_nextRow;
+	int total = (int)m_exporter->m_rows.size();
+
+	delete m_exporter;
+	m_exporter = nullptr;
+
+	if (cb) cb(this, FLE_LISTVIEW_EXPORT_CANCELLED, written, total, data);
+}
+
+bool Fle_Listview::is_exporting() const
+{
+	return m_exporter != nullptr;
+}
+
+void Fle_Listview::export_timeout_cb(void* data)
+{
+	((Fle_Listview*)data)->export_step();
+}
+
+void Fle_Listview::export_step()
+{
+	Fle_Listview_Export_Status status = m_exporter->step();
+
+	Fle_Listview_Export_Callback* cb = m_exporter->m_callback;
+	void* data = m_exporter->m_callbackData;
+	int written = m_exporter->m_nextRow;
+	int total = (int)m_exporter->m_rows.size();
+
+	if (status == FLE_LISTVIEW_EXPORT_RUNNING)
+	{
+		Fl::repeat_timeout(FLE_LISTVIEW_FRAME_TIME, export_timeout_cb, this);
+	}
+	else
+	{
+		delete m_exporter;
+		m_exporter = nullptr;
+	}
+
+	// The callback comes last, it may start another export
+	if (cb) cb(this, status, written, total, data);
+}
+
+void Fle_Listview::deselect_all(int otherThan)
+{
+	if(m_selected.size() == 0) return;
+	set_redraw(false);
+
+	// The selection is replaced in one go, erasing the entries one by one is
+	// quadratic. Callbacks already see the final selection.
+	std::vector<int> deselected;
+	deselected.swap(m_selected);
+	for (int i = 0; i < deselected.size(); i++)
+	{
+		if (deselected[i] == otherThan)
+		{
+			m_selected.push_back(otherThan);
+			break;
+		}
+	}
+
+	for (int i = 0; i < deselected.size(); i++)
+	{
+		if (deselected[i] == otherThan) continue;
+
+		Fle_Listview_Item* item = get_item(deselected[i]);
+		item->set_selected(false);
+		if (when() & FL_WHEN_CHANGED)
+		{
+			do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+		}
+	}
+	set_redraw(true);
+
+	listview_redraw();
+}
+
+void Fle_Listview::select_item(int index, bool selected)
+{
+	if(index > m_items.size() - 1) return;
+	Fle_Listview_Item* item = get_item(index);
+
+	if (!selected && item->is_selected())
+	{
+		m_selected.erase(std::find(m_selected.begin(), m_selected.end(), index));
+		item->set_selected(false);
+		if(when() & FL_WHEN_CHANGED)
+		{
+			do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+		}
+		listview_redraw();
+		return;
+	}
+
+	bool wasSelected = item->is_selected();
+	item->set_selected(true);
+
+	if (!wasSelected)
+	{
+		m_selected.push_back(index);
+	}
+
+	if(when() & FL_WHEN_CHANGED)
+	{
+		if (wasSelected)
+		{
+			do_callback_for_item(item, FLE_LISTVIEW_REASON_RESELECTED);
+		}
+		else
+		{
+			do_callback_for_item(item, FLE_LISTVIEW_REASON_SELECTED);
+		}
+	}
+	listview_redraw();
+}
+
+void Fle_Listview::select_item(Fle_Listview_Item* item, bool selected)
+{
+	select_item(std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item)), selected);
+}
+
+int Fle_Listview::get_item_count() const
+{
+	return m_items.size();
+}
+
+int Fle_Listview::get_selected_count() const
+{
+	return m_selected.size();
+}
+
+Fle_Listview_Display_Mode Fle_Listview::get_display_mode() const
+{
+	return m_displayMode;
+}
+
+Fle_Listview_Item* Fle_Listview::get_item(int index) const
+{
+	return m_items[index];
+}
+
+Fle_Listview_Item* Fle_Listview::get_item_at(int X, int Y) const
+{
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && Y < y() + m_headersHeight)
+		return nullptr;
+
+	if (m_gridPerLine > 0 && m_gridCellW > 0 && m_gridCellH > 0)
+	{
+		// Only the item in the grid cell under the coordinates can contain them
+		int cellX = X - x() - m_margin + m_hscrollbar.value();
+		int cellY = Y - y() - m_margin + m_vscrollbar.value() - m_gridOriginY;
+		if (cellX < 0 || cellY < 0) return nullptr;
+
+		int column = cellX / m_gridCellW;
+		int row = cellY / m_gridCellH;
+		int index;
+
+		if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST)
+		{
+			if (row >= m_gridPerLine) return nullptr;
+			index = column * m_gridPerLine + row;
+		}
+		else if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && m_rowIndex->size() == (int)m_items.size())
+		{
+			// Rows have their own heights
+			index = get_item_at_offset(cellY);
+			update_item_position(index);
+		}
+		else
+		{
+			if (column >= m_gridPerLine) return nullptr;
+			index = row * m_gridPerLine + column;
+		}
+
+		if (index < 0 || index >= m_items.size()) return nullptr;
+
+		Fle_Listview_Item* item = m_items[index];
+		if(X >= item->x() && X < item->x() + item->w() && Y >= item->y() && Y < item->y() + item->h())
+			return item;
+
+		return nullptr;
+	}
+
+	for (Fle_Listview_Item* item : m_items)
+	{
+		if(X >= item->x() && X < item->x() + item->w() && Y >= item->y() && Y < item->y() + item->h())
+		{
+			return item;
+		}
+	}
+
+	return nullptr;
+}
+
+Fle_Listview::Interaction::Interaction()
+{
+	reset();
+}
+
+void Fle_Listview::Interaction::reset()
+{
+	dragX = 0;
+	dragY = 0;
+	resizingHeaderProperty = -2;
+	resizeStartWidth = 0;
+	resizeWidth = 0;
+	lastGridX = 0;
+	lastGridY = 0;
+	itemDrag = false;
+	hitItem = nullptr;
+	tooltipItem = nullptr;
+	hitX = 0;
+	hitY = 0;
+	hitScrollX = 0;
+	hitScrollY = 0;
+	hitValid = false;
+	headerDragIndex = -1;
+	headerDragGrabX = 0;
+	headerDragX = 0;
+	headerDragLeft = 0;
+	headerDragFirst = 0;
+	headerDragLast = -1;
+	headerDragging = false;
+}
+
+void Fle_Listview::Interaction::forget_item(Fle_Listview_Item* item)
+{
+	if (item == tooltipItem) tooltipItem = nullptr;
+
+	// Removing any item shifts the ones after it, so the memoized hit can't be trusted
+	hitItem = nullptr;
+	hitValid = false;
+}
+
+Fle_Listview_Item* Fle_Listview::hit_test(int X, int Y)
+{
+	Interaction& state = m_interaction;
+
+	if (state.hitValid && X == state.hitX && Y == state.hitY && m_hscrollbar.value() == state.hitScrollX && m_vscrollbar.value() == state.hitScrollY)
+		return state.hitItem;
+
+	state.hitItem = get_item_at(X, Y);
+	state.hitX = X;
+	state.hitY = Y;
+	state.hitScrollX = m_hscrollbar.value();
+	state.hitScrollY = m_vscrollbar.value();
+	state.hitValid = true;
+
+	return state.hitItem;
+}
+
+void Fle_Listview::tooltip_timeout_cb(void* data)
+{
+	Fle_Listview* lv = (Fle_Listview*)data;
+
+	if (!lv->contains(Fl::belowmouse())) return;
+
+	Fle_Listview_Item* atItem = lv->hit_test(Fl::event_x(), Fl::event_y());
+	if (atItem == lv->m_interaction.tooltipItem) return;
+
+	lv->m_interaction.tooltipItem = atItem;
+
+	Fl_Tooltip::enter(nullptr);
+	if(atItem)
+	{
+		lv->copy_tooltip(atItem->get_tooltip().c_str());
+	}
+	else
+	{
+		lv->copy_tooltip("");
+	}
+	Fl_Tooltip::enter(lv);
+}
+
+Fle_Listview_Item* Fle_Listview::get_item_drag_at(int x, int y) const
+{
+	Fle_Listview_Item* item = get_item_at(x, y);
+	
+	if (item && item->is_inside_drag_area(x, y))
+		return item;
+
+	return nullptr;
+}
+
+Fle_Listview_Item* Fle_Listview::get_callback_item() const
+{
+	return m_callbackItem;
+}
+
+const std::vector<int>& Fle_Listview::get_selected() const
+{
+	return m_selected;
+}
+
+void Fle_Listview::get_selected_ranges(std::vector<std::pair<int, int>>& ranges) const
+{
+	ranges.clear();
+
+	std::vector<int> selected = m_selected;
+	std::sort(selected.begin(), selected.end());
+
+	for (int i = 0; i < selected.size(); i++)
+	{
+		if (!ranges.empty() && ranges.back().second == selected[i] - 1)
+			ranges.back().second = selected[i];
+		else
+			ranges.push_back(std::make_pair(selected[i], selected[i]));
+	}
+}
+
+void Fle_Listview::set_display_mode(Fle_Listview_Display_Mode mode)
+{
+	if (mode == m_displayMode) return;
+
+	save_anchor();
+
+	m_displayMode = mode;
+
+	m_vscrollbar.value(0);
+	m_hscrollbar.value(0);
+
+	for (int i = 0; i < m_items.size(); i++)
+	{
+		m_items[i]->set_display_mode(mode);
+	}
+
+	// Only the small icons and list modes need the widest label
+	if (mode != FLE_LISTVIEW_DISPLAY_SMALL_ICONS && mode != FLE_LISTVIEW_DISPLAY_LIST)
+	{
+		m_labelWidths.clear();
+		m_labelWidthsValid = false;
+	}
+
+	arrange_items();
+}
+
+void Fle_Listview::ensure_item_visible(int item)
+{
+	update_item_position(item);
+	ensure_item_visible(get_item(item));
+}
+
+void Fle_Listview::ensure_item_visible(Fle_Listview_Item* item)
+{
+	update_item_position(item);
+
+	int scrollX = m_hscrollbar.value();
+	int scrollY = m_vscrollbar.value();
+
+	Fle_Listview_Display_Mode mode = get_display_mode();
+
+	if (mode == FLE_LISTVIEW_DISPLAY_LIST)
+	{
+		if (item->x() < x() || item->w() > w())
+		{
+			m_hscrollbar.value(scrollX - (x() - item->x() + m_margin));
+		}
+		else if(item->x() + item->w() > x() + w())
+		{
+			m_hscrollbar.value(scrollX - (x() + w() - item->x() - item->w() + m_margin));
+		}
+	}
+	else
+	{
+		if (item->y() < y() + (mode == FLE_LISTVIEW_DISPLAY_DETAILS ? m_headersHeight : 0) || item->h() > h())
+		{
+			m_vscrollbar.value(scrollY - (y() + (mode == FLE_LISTVIEW_DISPLAY_DETAILS ? m_headersHeight : 0) - item->y()));
+		}
+		else if (item->y() + item->h() > y() + h())
+		{
+			m_vscrollbar.value(scrollY - (y() + h() - item->y() - item->h()));
+		}
+	}
+
+	listview_redraw();
+}
+
+void Fle_Listview::set_redraw(bool redraw)
+{
+	if (redraw)
+	{
+		m_state |= FLE_LISTVIEW_REDRAW;
+	}
+	else
+		m_state &= ~FLE_LISTVIEW_REDRAW;
+
+}
+
+int Fle_Listview::handle(int e)
+{
+	if (e == FL_ENTER) return 1;
+	if (e == FL_LEAVE)
+	{
+		Fl::remove_timeout(tooltip_timeout_cb, this);
+		return 1;
+	}
+
+	int ret = Fl_Group::handle(e);
+
+	// Mouse events inside the label editor belong to it
+	if (m_editedItem && m_labelEditor->visible() && ret && (e == FL_PUSH || e == FL_DRAG || e == FL_RELEASE) && Fl::event_inside(m_labelEditor))
+		return ret;
+
+	int ex = Fl::event_x();
+	int ey = Fl::event_y();
+	int gridX, gridY;
+
+	// Hit testing is done only for the pointer events that need it. The
+	// tooltip follows the pointer once it rests, not on every motion event.
+	if (e == FL_MOVE && item_tooltips())
+	{
+		Fl::remove_timeout(tooltip_timeout_cb, this);
+		Fl::add_timeout(FLE_LISTVIEW_TOOLTIP_DELAY, tooltip_timeout_cb, this);
+	}
+
+	if (dnd())
+	{
+		if (e == FL_DND_ENTER || e == FL_DND_DRAG || e == FL_DND_RELEASE)
+			return 1;
+
+		if(e == FL_PASTE)
+		{
+			if (when() & FL_WHEN_CHANGED)
+			{
+				do_callback((Fl_Callback_Reason)FLE_LISTVIEW_REASON_DND_END);
+			}
+			return 1;
+		}
+	}
+	if (e == FL_PUSH)
+	{
+		if(Fl::focus() != this)
+		{
+			Fl::focus(this);
+		}
+		// Clicking a group header collapses or expands the group
+		int group = get_group_header_at(ex, ey);
+		if (group != -1)
+		{
+			set_group_collapsed(group, !m_groups[group].collapsed);
+			return 1;
+		}
+
+		Fle_Listview_Item* atItem = hit_test(ex, ey);
+
+		// Clicking the arrow of a tree-list item, or double clicking the item, expands or collapses it
+		if (atItem && tree_list() && atItem->m_expandable && get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS)
+		{
+			int arrowX = atItem->x() + atItem->get_tree_indent() - 16;
+			int index = get_item_at_offset(ey - y() - m_margin + m_vscrollbar.value() - m_gridOriginY);
+
+			if (index != -1 && m_items[index] == atItem && ((ex >= arrowX && ex < arrowX + 16) || Fl::event_clicks()))
+			{
+				expand_item(index, !atItem->m_expanded);
+				return 1;
+			}
+		}
+
+		if (atItem)
+		{
+			if (dnd() && atItem->is_inside_drag_area(ex, ey) && atItem->is_selected() && !Fl::event_ctrl())
+			{
+				m_interaction.itemDrag = true;
+			}
+			bool selected = true;
+			if (atItem->is_selected() && Fl::event_ctrl()) selected = false;
+			handle_user_selection(atItem, selected, true, m_interaction.itemDrag);
+		}
+		else if (ret != 1 && m_displayMode != FLE_LISTVIEW_DISPLAY_TOOLBOX) // Always keep one tool selected
+		{
+			// Clear selection
+			deselect_all();
+		}
+
+		// Resize header bars by dragging
+		m_interaction.resizingHeaderProperty = -2;
+		if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && ex > x() && ex < x() + w() && ey > y() && ey <= y() + m_headersHeight)
+		{
+			int prop = get_header_property_at(ex, true);
+			if (prop >= 0)
+			{
+				m_interaction.resizingHeaderProperty = prop;
+				m_interaction.resizeStartWidth = m_propertyHeaderWidths[prop];
+				m_interaction.resizeWidth = m_propertyHeaderWidths[prop];
+				window()->cursor(FL_CURSOR_WE);
+			}
+			else
+			{
+				// Scrolled property headers can be dragged to reorder them
+				prop = get_header_property_at(ex, false);
+				int index = (int)(std::find(m_propertyOrder.begin(), m_propertyOrder.end(), prop) - m_propertyOrder.begin());
+
+				if (prop >= 0 && index < (int)m_propertyOrder.size() - std::max(m_pinnedColumns - 1, 0))
+				{
+					m_interaction.headerDragIndex = index;
+					m_interaction.headerDragGrabX = ex - (x() + m_margin - m_hscrollbar.value() + m_columnEdges[index + 1]);
+					m_interaction.headerDragX = ex;
+				}
+			}
+		}
+
+		// Selection box
+		m_interaction.dragX = ex;
+		m_interaction.dragY = ey;
+
+		get_grid_xy_at(ex, ey, gridX, gridY);
+
+		return 1;
+	}
+	else if (e == FL_MOUSEWHEEL)
+	{
+		end_label_edit(true);
+		m_scrollPending += Fl::event_dy() * (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST ? 10 : 5);
+
+		// Wheel events are merged until the next frame. The first one after
+		// a pause is applied immediately.
+		if (!Fl::has_timeout(scroll_timeout_cb, this))
+			scroll_frame();
+
+		return 1;
+	}
+	else if (e == FL_DRAG && m_interaction.headerDragIndex != -1)
+	{
+		if (!m_interaction.headerDragging && std::abs(ex - m_interaction.dragX) >= 6)
+			begin_header_drag();
+
+		if (m_interaction.headerDragging)
+		{
+			m_interaction.headerDragX = ex;
+			redraw();
+		}
+
+		return 1;
+	}
+	else if (e == FL_DRAG)
+	{
+		int scrollTo = 0;
+		get_grid_xy_at(ex, ey, gridX, gridY);
+
+		if(get_display_mode() != FLE_LISTVIEW_DISPLAY_DETAILS)
+		{
+			if (ex > x() + w())
+			{
+				scrollTo = m_hscrollbar.value() + 3;
+				if (scrollTo <= m_itemsBBoxX - w())
+				{
+					m_hscrollbar.value(scrollTo);
+					m_interaction.dragX -= 3;
+					update_scrollbars();
+					listview_redraw();
+				}
+			}
+			if (ex < x())
+			{
+				scrollTo = m_hscrollbar.value() - 3;
+				if (scrollTo >= 0)
+				{
+					m_hscrollbar.value(scrollTo);
+					m_interaction.dragX += 3;
+					update_scrollbars();
+					listview_redraw();
+				}
+			}
+		}
+		else if(m_interaction.resizingHeaderProperty != -2)
+		{
+			// Resize property header. Only the header and a guide line follow
+			// the pointer, the items are laid out again on release.
+			int prop = m_interaction.resizingHeaderProperty;
+			int newval = m_interaction.resizeStartWidth + m_interaction.dragX - ex;
+
+			// The name column shrinks down to it's minimum width, after that
+			// the columns scroll horizontally
+			newval = std::max(newval, m_propertyHeaderMinWidths[prop]);
+
+			if (newval != m_interaction.resizeWidth)
+			{
+				m_interaction.resizeWidth = newval;
+
+				if (!m_headerDragSnapshot)
+					m_headerDragSnapshot = fl_capture_window(window(), x(), y(), w(), h());
+
+				redraw();
+			}
+
+			return 1;
+		}
+		if (ey > y() + h())
+		{
+			scrollTo = m_vscrollbar.value() + 3;
+			if (scrollTo <= m_itemsBBoxY -h())
+			{
+				m_vscrollbar.value(scrollTo);
+				m_interaction.dragY -= 3;
+				update_scrollbars();
+				listview_redraw();
+			}
+		}
+		if (ey < y())
+		{
+			scrollTo = m_vscrollbar.value() - 3;
+			if (scrollTo >= 0)
+			{
+				m_vscrollbar.value(scrollTo);
+				m_interaction.dragY += 3;
+				update_scrollbars();
+				listview_redraw();
+			}
+		}
+
+		if (m_interaction.resizingHeaderProperty == -2 && !single_selection() && (std::abs(m_interaction.dragX - ex) >= 6 || std::abs(m_interaction.dragY - ey) >= 6))
+		{
+			if(gridX != m_interaction.lastGridX || gridY != m_interaction.lastGridY)
+			{
+				if (m_interaction.itemDrag)
+				{
+					// Start drag of selected items
+					if (when() & FL_WHEN_CHANGED)
+					{
+						if (m_dndFormat != FLE_LISTVIEW_DND_NONE) copy_dnd_payload();
+						do_callback((Fl_Callback_Reason)FLE_LISTVIEW_REASON_DND_START);
+
+						// Fl::dnd() returns once the items are dropped
+						s_dndSource = this;
+						Fl::dnd();
+						s_dndSource = nullptr;
+
+						return 1;
+					}
+				}
+				else
+				{
+					drag_select(m_interaction.dragX, m_interaction.dragY, ex, ey);
+					window()->make_current();
+					listview_redraw();
+					m_interaction.lastGridX = gridX;
+					m_interaction.lastGridY = gridY;
+				}
+			}
+
+			window()->make_current();
+			fl_overlay_rect(m_interaction.dragX, m_interaction.dragY, ex - m_interaction.dragX, ey - m_interaction.dragY);
+
+			return 1;
+		}
+	}
+	else if (e == FL_RELEASE)
+	{
+		window()->make_current();
+		fl_overlay_clear();
+
+		if (m_interaction.itemDrag)
+		{
+			deselect_all(m_lastSelectedItem);
+		}
+		m_interaction.itemDrag = false;
+
+		if (m_interaction.headerDragging)
+		{
+			end_header_drag();
+			return 1;
+		}
+		m_interaction.headerDragIndex = -1;
+
+		// Check for clicks on headers
+		if (m_interaction.resizingHeaderProperty == -2 && get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS)
+		{
+			if (ex > x() && ex < x() + w() && ey > y() && ey <= y() + m_headersHeight)
+			{
+				int prop = get_header_property_at(ex, false);
+
+				if (prop >= 0)
+				{
+					// Clicked on a property
+					if (m_sortedByProperty == prop)
+					{
+						sort_items(m_state & FLE_LISTVIEW_SORTED_DESCENDING, prop);
+					}
+					else
+						sort_items(true, prop);
+					return 1;
+				}
+				// Clicked on the name, not any other added properties
+				if (m_sortedByProperty == -1)
+				{
+					sort_items(m_state & FLE_LISTVIEW_SORTED_DESCENDING, -1);
+				}
+				else
+					sort_items(true, -1);
+				return 1;
+			}
+		}
+		if (m_interaction.resizingHeaderProperty != -2)
+		{
+			window()->cursor(FL_CURSOR_DEFAULT);
+
+			delete m_headerDragSnapshot;
+			m_headerDragSnapshot = nullptr;
+
+			if (m_interaction.resizeWidth != m_propertyHeaderWidths[m_interaction.resizingHeaderProperty])
+			{
+				m_propertyHeaderWidths[m_interaction.resizingHeaderProperty] = m_interaction.resizeWidth;
+				m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+			}
+			m_interaction.resizingHeaderProperty = -2;
+			listview_redraw();
+
+			return 1;
+		}
+	}
+	else if (e == FL_FOCUS)
+	{
+		if(m_items.size() > 0 && m_focusedItem == -1)
+		{
+			set_focused(0);
+		}
+		return 1;
+	}
+	else if(e == FL_UNFOCUS)
+	{
+		redraw();
+		return 1;
+	}
+	else if (e == FL_KEYDOWN && Fl::focus() == this)
+	{
+		switch (Fl::event_key())
+		{
+		case FL_Up:
+		case FL_Down:
+		case FL_Right:
+		case FL_Left:
+		case FL_Page_Up:
+		case FL_Page_Down:
+		case FL_Home:
+		case FL_End:
+			keyboard_select(Fl::event_key());
+			return 1;
+			break;
+		case FL_F + 2:
+			if (edit_labels() && m_focusedItem != -1)
+			{
+				edit_item_label(m_focusedItem);
+				return 1;
+			}
+			break;
+		case ' ':
+			if(m_focusedItem != -1)
+				handle_user_selection(m_items[m_focusedItem], true, true, false);
+			break;
+		case 'a':
+			if (Fl::event_ctrl() && !single_selection())
+			{
+				for (int i = 0; i < m_items.size(); i++)
+				{
+					select_item(i, true);
+				}
+			}
+			break;
+		}
+	}
+
+	return ret;
+}
+
+void Fle_Listview::edit_labels(bool edit)
+{
+	if (edit)
+	{
+		m_state |= FLE_LISTVIEW_EDIT_LABELS;
+	}
+	else
+	{
+		m_state &= ~FLE_LISTVIEW_EDIT_LABELS;
+		end_label_edit(false);
+	}
+}
+
+void Fle_Listview::edit_item_label(int index)
+{
+	if (index < 0 || index > (int)m_items.size() - 1) return;
+
+	end_label_edit(true);
+
+	if (!m_labelEditor)
+	{
+		// Created on first use and kept hidden between edits
+		Fl_Group* current = Fl_Group::current();
+		Fl_Group::current(nullptr);
+		m_labelEditor = new Fle_Label_Editor(this);
+		Fl_Group::current(current);
+		add(m_labelEditor);
+	}
+
+	if (m_state & FLE_LISTVIEW_NEEDS_ARRANGING) arrange_items();
+
+	Fle_Listview_Item* item = m_items[index];
+	ensure_item_visible(item);
+
+	m_editedItem = item;
+	m_editedIndex = index;
+
+	m_labelEditor->textfont(labelfont());
+	m_labelEditor->textsize(labelsize());
+	m_labelEditor->value(item->get_name().c_str());
+	place_label_editor();
+	m_labelEditor->show();
+	m_labelEditor->take_focus();
+	m_labelEditor->insert_position(m_labelEditor->size(), 0);
+
+	listview_redraw();
+}
+
+void Fle_Listview::end_label_edit(bool commit)
+{
+	Fle_Listview_Item* item = m_editedItem;
+	if (!item) return;
+
+	// Cleared first, hiding the editor finishes the edit again otherwise
+	m_editedItem = nullptr;
+
+	std::string name = m_labelEditor->value();
+	bool hadFocus = Fl::focus() == m_labelEditor;
+	m_labelEditor->hide();
+	if (hadFocus) Fl::focus(this);
+
+	if (commit && name != item->get_name())
+	{
+		int index = m_editedIndex;
+		if (index < 0 || index > (int)m_items.size() - 1 || m_items[index] != item)
+			index = std::distance(m_items.begin(), std::find(m_items.begin(), m_items.end(), item));
+
+		rename_item(index, name);
+	}
+
+	listview_redraw();
+}
+
+Fle_Listview_Item* Fle_Listview::get_edited_item() const
+{
+	return m_editedItem;
+}
+
+void Fle_Listview::place_label_editor()
+{
+	update_item_position(m_editedItem);
+
+	int X, Y, W, H;
+	m_editedItem->get_text_xywh(X, Y, W, H);
+
+	// In details mode the text rectangle spans the whole row
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS)
+		W = std::min(W, m_columnWidth - 16);
+
+	H = std::max(H, labelsize() + 6);
+
+	m_labelEditor->resize(X, Y, std::max(W, 20), H);
+}
+
+void Fle_Listview::rename_item(int index, const std::string& name)
+{
+	Fle_Listview_Item* item = m_items[index];
+	Fle_Listview_Display_Mode mode = get_display_mode();
+
+	untrack_label_width(item);
+	item->set_name(name);
+	item->set_display_name();
+	item->m_labelWidth = -1;
+	track_label_width(item);
+
+	// A renamed tree-list item would have to move with it's descendants, the
+	// list is no longer considered sorted instead
+	if (tree_list())
+	{
+		m_state &= ~(FLE_LISTVIEW_SORTED_ASCENDING | FLE_LISTVIEW_SORTED_DESCENDING);
+		m_sortedByProperty = -2;
+		invalidate_header_cache();
+	}
+
+	// Keep the list sorted by moving only the renamed item
+	if (m_state & (FLE_LISTVIEW_SORTED_ASCENDING | FLE_LISTVIEW_SORTED_DESCENDING))
+	{
+		int to = get_sorted_position(index);
+		move_item(index, to);
+		index = to;
+	}
+
+	// The new name may change the widest label, and with it the columns of the
+	// small icons and list modes. Otherwise the items keep their cells.
+	if ((mode == FLE_LISTVIEW_DISPLAY_SMALL_ICONS || mode == FLE_LISTVIEW_DISPLAY_LIST) && m_labelWidthsValid)
+	{
+		int widest = m_labelWidths.empty() ? 0 : std::min(*m_labelWidths.rbegin() + 16, 200);
+		if (widest != m_columnWidth) m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	}
+
+	if (when() & FL_WHEN_CHANGED) do_callback_for_item(item, FLE_LISTVIEW_REASON_RENAMED);
+
+	if (!(m_state & FLE_LISTVIEW_NEEDS_ARRANGING)) ensure_item_visible(item);
+	listview_redraw();
+}
+
+bool Fle_Listview::is_sorted_before(Fle_Listview_Item* a, Fle_Listview_Item* b) const
+{
+	if (m_state & FLE_LISTVIEW_SORTED_ASCENDING)
+		return b->is_greater(a, m_sortedByProperty);
+
+	return a->is_greater(b, m_sortedByProperty);
+}
+
+int Fle_Listview::get_sorted_position(int index) const
+{
+	Fle_Listview_Item* item = m_items[index];
+	int low = 0;
+	int high = (int)m_items.size() - 1;
+
+	// Grouped items are sorted within their group
+	if (grouped_rows() && !(m_state & FLE_LISTVIEW_NEEDS_GROUPING) && !m_groups.empty())
+	{
+		const Group& group = m_groups[find_item_group(index)];
+		low = group.first;
+		high = group.first + group.count - 1;
+	}
+
+	if ((index == low || !is_sorted_before(item, m_items[index - 1])) && (index == high || !is_sorted_before(m_items[index + 1], item)))
+		return index;
+
+	// Binary search over the other items, as if the item was removed
+	while (low < high)
+	{
+		int middle = (low + high) / 2;
+		Fle_Listview_Item* other = m_items[middle < index ? middle : middle + 1];
+
+		if (is_sorted_before(item, other))
+			high = middle;
+		else
+			low = middle + 1;
+	}
+
+	return low;
+}
+
+void Fle_Listview::update_item(int index)
+{
+	update_items(index, index);
+}
+
+void Fle_Listview::update_items(int first, int last)
+{
+	first = std::max(first, 0);
+	last = std::min(last, (int)m_items.size() - 1);
+	if (first > last) return;
+
+	for (int i = first; i <= last; i++)
+	{
+		Fle_Listview_Item* item = m_items[i];
+
+		untrack_label_width(item);
+		item->set_display_name();
+		item->m_labelWidth = -1;
+		track_label_width(item);
+	}
+
+	// Items whose group key changed go to another group
+	if (grouped_rows() && !(m_state & FLE_LISTVIEW_NEEDS_GROUPING) && !m_groups.empty())
+	{
+		for (int i = first; i <= last; i++)
+		{
+			if (m_groups[find_item_group(i)].key != m_items[i]->get_group())
+			{
+				m_state |= FLE_LISTVIEW_NEEDS_GROUPING;
+				break;
+			}
+		}
+	}
+
+	int changedFirst = first;
+	int changedLast = last;
+
+	if (m_state & (FLE_LISTVIEW_SORTED_ASCENDING | FLE_LISTVIEW_SORTED_DESCENDING))
+	{
+		// The items and their neighbours are usually still in order. Neighbours
+		// from different groups aren't compared.
+		bool inOrder = true;
+		for (int i = std::max(first, 1); i <= std::min(last + 1, (int)m_items.size() - 1) && inOrder; i++)
+		{
+			if (grouped_rows() && m_items[i]->get_group() != m_items[i - 1]->get_group()) continue;
+
+			inOrder = !is_sorted_before(m_items[i], m_items[i - 1]);
+		}
+
+		if (!inOrder && tree_list())
+		{
+			// As with renaming, moving items of a tree-list would break it
+			m_state &= ~(FLE_LISTVIEW_SORTED_ASCENDING | FLE_LISTVIEW_SORTED_DESCENDING);
+			m_sortedByProperty = -2;
+			invalidate_header_cache();
+		}
+		else if (!inOrder && first == last)
+		{
+			int to = get_sorted_position(first);
+			move_item(first, to);
+
+			changedFirst = std::min(first, to);
+			changedLast = std::max(last, to);
+		}
+		else if (!inOrder)
+		{
+			merge_sorted_range(first, last);
+		}
+	}
+
+	// The widest label decides the columns of the small icons and list modes
+	Fle_Listview_Display_Mode mode = get_display_mode();
+	if ((mode == FLE_LISTVIEW_DISPLAY_SMALL_ICONS || mode == FLE_LISTVIEW_DISPLAY_LIST) && m_labelWidthsValid)
+	{
+		int widest = m_labelWidths.empty() ? 0 : std::min(*m_labelWidths.rbegin() + 16, 200);
+		if (widest != m_columnWidth) m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	}
+
+	if (m_editedItem) place_label_editor();
+
+	if (m_state & (FLE_LISTVIEW_NEEDS_ARRANGING | FLE_LISTVIEW_NEEDS_GROUPING))
+		listview_redraw();
+	else
+		damage_items(changedFirst, changedLast);
+}
+
+void Fle_Listview::merge_sorted_range(int first, int last)
+{
+	Fle_Listview_Item* focused = m_focusedItem != -1 ? m_items[m_focusedItem] : nullptr;
+	Fle_Listview_Item* lastSelected = m_lastSelectedItem != -1 ? m_items[m_lastSelectedItem] : nullptr;
+
+	std::vector<Fle_Listview_Item*> selected(m_selected.size());
+	for (int i = 0; i < m_selected.size(); i++)
+	{
+		selected[i] = m_items[m_selected[i]];
+	}
+
+	std::vector<Fle_Listview_Item*> range(m_items.begin() + first, m_items.begin() + last + 1);
+	m_items.erase(m_items.begin() + first, m_items.begin() + last + 1);
+
+	// Grouped items are sorted only within their group, the groups follow
+	// each other in key order as build_groups() puts them
+	bool grouped = grouped_rows();
+	std::function<bool(Fle_Listview_Item*, Fle_Listview_Item*)> order = [this, grouped](Fle_Listview_Item* a, Fle_Listview_Item* b)
+	{
+		if (grouped && a->get_group() != b->get_group()) return a->get_group() < b->get_group();
+
+		return is_sorted_before(a, b);
+	};
+	std::stable_sort(range.begin(), range.end(), order);
+
+	std::vector<Fle_Listview_Item*> merged;
+	merged.reserve(m_items.size() + range.size());
+	std::merge(m_items.begin(), m_items.end(), range.begin(), range.end(), std::back_inserter(merged), order);
+	m_items.swap(merged);
+
+	// Selection and focus stay on the same items
+	std::map<Fle_Listview_Item*, int> indices;
+	for (int i = 0; i < m_items.size(); i++)
+	{
+		if (m_items[i]->is_selected() || m_items[i] == focused || m_items[i] == lastSelected)
+			indices[m_items[i]] = i;
+	}
+
+	for (int i = 0; i < selected.size(); i++)
+	{
+		m_selected[i] = indices[selected[i]];
+	}
+	if (focused) m_focusedItem = indices[focused];
+	if (lastSelected) m_lastSelectedItem = indices[lastSelected];
+	m_keyFocusPending = -1;
+
+	// The groups keep their order, only their ranges have to be found again
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	if (grouped_rows()) m_state |= FLE_LISTVIEW_NEEDS_GROUPING;
+	m_interaction.hitValid = false;
+}
+
+void Fle_Listview::damage_items(int first, int last)
+{
+	if (!(m_state & FLE_LISTVIEW_REDRAW)) return;
+
+	int visibleFirst, visibleLast;
+	get_visible_range(visibleFirst, visibleLast);
+
+	first = std::max(first, visibleFirst);
+	last = std::min(last, visibleLast);
+
+	int top = get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS ? y() + m_headersHeight : y();
+
+	for (int i = next_shown_item(first, 1); i <= last; i = next_shown_item(i + 1, 1))
+	{
+		update_item_position(i);
+
+		Fle_Listview_Item* item = m_items[i];
+		int X = std::max(item->x(), x());
+		int Y = std::max(item->y(), top);
+		int R = std::min(item->x() + item->w(), x() + w());
+		int B = std::min(item->y() + item->h(), y() + h());
+
+		if (R > X && B > Y) damage(FL_DAMAGE_ALL, X, Y, R - X, B - Y);
+	}
+}
+
+void Fle_Listview::move_item(int from, int to)
+{
+	if (from == to) return;
+
+	std::vector<Fle_Listview_Item*>::iterator begin = m_items.begin();
+	if (from < to)
+		std::rotate(begin + from, begin + from + 1, begin + to + 1);
+	else
+		std::rotate(begin + to, begin + from, begin + from + 1);
+
+	// Indices between the two positions shift by one towards from
+	int low = std::min(from, to);
+	int high = std::max(from, to);
+	int shift = from < to ? -1 : 1;
+
+	for (int i = 0; i < m_selected.size(); i++)
+	{
+		int& selected = m_selected[i];
+		if (selected == from) selected = to;
+		else if (selected >= low && selected <= high) selected += shift;
+	}
+
+	if (m_focusedItem == from) m_focusedItem = to;
+	else if (m_focusedItem >= low && m_focusedItem <= high) m_focusedItem += shift;
+
+	if (m_lastSelectedItem == from) m_lastSelectedItem = to;
+	else if (m_lastSelectedItem >= low && m_lastSelectedItem <= high) m_lastSelectedItem += shift;
+
+	place_items(low, high);
+}
+
+void Fle_Listview::place_items(int first, int last)
+{
+	if (m_gridPerLine <= 0 || (m_state & FLE_LISTVIEW_NEEDS_ARRANGING))
+	{
+		m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+		return;
+	}
+
+	if (get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && m_rowIndex->size() == (int)m_items.size())
+	{
+		// Moved items take their row heights along. The heights in the range
+		// add up the same, so the rows after it don't move.
+		for (int i = first; i <= last; i++)
+		{
+			int delta = m_items[i]->m_rowHeight - m_rowIndex->get(i);
+			if (delta != 0) m_rowIndex->add(i, delta);
+		}
+		for (int i = first; i <= last; i++)
+			place_row(i);
+
+		m_interaction.hitValid = false;
+		return;
+	}
+
+	// The same cells arrange_items() puts the items in
+	for (int i = first; i <= last; i++)
+	{
+		int line = i / m_gridPerLine;
+		int cell = i % m_gridPerLine;
+
+		if (get_display_mode() == FLE_LISTVIEW_DISPLAY_LIST)
+			m_items[i]->resize(line * m_gridCellW, cell * m_gridCellH, m_gridCellW, m_gridCellH);
+		else
+			m_items[i]->resize(cell * m_gridCellW, m_gridOriginY + line * m_gridCellH, m_gridCellW, m_gridCellH);
+	}
+
+	m_interaction.hitValid = false;
+}
+
+void Fle_Listview::tree_list(bool tree)
+{
+	if (tree == tree_list()) return;
+
+	if (tree)
+	{
+		grouped_rows(false);
+		m_state |= FLE_LISTVIEW_TREE_LIST;
+	}
+	else
+	{
+		m_state &= ~FLE_LISTVIEW_TREE_LIST;
+	}
+
+	listview_redraw();
+}
+
+void Fle_Listview::set_children_callback(Fle_Listview_Children_Callback* cb, void* data)
+{
+	m_childrenCallback = cb;
+	m_childrenCallbackData = data;
+}
+
+void Fle_Listview::add_child_item(Fle_Listview_Item* parent, Fle_Listview_Item* child)
+{
+	if (parent == nullptr)
+	{
+		add_item(child);
+		return;
+	}
+
+	child->m_treeParent = parent;
+	child->m_treeDepth = parent->m_treeDepth + 1;
+	child->m_listview = this;
+	child->m_labelWidth = -1;
+	child->set_display_mode(get_display_mode());
+
+	parent->m_children.push_back(child);
+	parent->m_expandable = true;
+	parent->m_childrenLoaded = true;
+
+	// Children of collapsed items, such as the ones added by the children
+	// callback, only get a row once their parent is expanded
+	std::vector<Fle_Listview_Item*>::iterator it = m_items.end();
+	if (parent->m_expanded) it = std::find(m_items.begin(), m_items.end(), parent);
+
+	if (it == m_items.end())
+	{
+		listview_redraw();
+		return;
+	}
+
+	save_anchor();
+
+	// The child follows the rows of it's older siblings
+	int end = (int)(it - m_items.begin()) + 1;
+	while (end < (int)m_items.size() && m_items[end]->m_treeDepth > parent->m_treeDepth) end++;
+
+	std::vector<Fle_Listview_Item*> rows;
+	append_tree_rows(rows, child);
+	insert_rows(end, rows);
+
+	m_state &= ~(FLE_LISTVIEW_SORTED_ASCENDING | FLE_LISTVIEW_SORTED_DESCENDING);
+	m_sortedByProperty = -2;
+
+	if (when() & FL_WHEN_CHANGED) do_callback_for_item(child, FLE_LISTVIEW_REASON_ADDED);
+
+	listview_redraw();
+}
+
+void Fle_Listview::expand_item(int index, bool expand)
+{
+	if (!tree_list() || index < 0 || index >= (int)m_items.size()) return;
+
+	Fle_Listview_Item* item = m_items[index];
+	if (!item->m_expandable || item->m_expanded == expand) return;
+
+	end_label_edit(true);
+	save_anchor();
+
+	if (expand)
+	{
+		// Children are asked for the first time the item is expanded
+		if (!item->m_childrenLoaded)
+		{
+			item->m_childrenLoaded = true;
+			if (m_childrenCallback) m_childrenCallback(this, item, m_childrenCallbackData);
+		}
+
+		item->m_expanded = true;
+
+		std::vector<Fle_Listview_Item*> rows;
+		for (int i = 0; i < item->m_children.size(); i++)
+		{
+			append_tree_rows(rows, item->m_children[i]);
+		}
+		insert_rows(index + 1, rows);
+
+		// An item turned out to have no children loses it's arrow
+		if (item->m_children.empty()) item->m_expandable = false;
+	}
+	else
+	{
+		item->m_expanded = false;
+
+		// The visible descendants are the deeper rows right after the item
+		int end = index + 1;
+		while (end < (int)m_items.size() && m_items[end]->m_treeDepth > item->m_treeDepth) end++;
+
+		remove_rows(index + 1, end - index - 1);
+	}
+
+	listview_redraw();
+}
+
+void Fle_Listview::insert_rows(int index, const std::vector<Fle_Listview_Item*>& rows)
+{
+	int count = (int)rows.size();
+	if (count == 0) return;
+
+	m_items.insert(m_items.begin() + index, rows.begin(), rows.end());
+
+	// Hidden rows may have missed a display mode change
+	for (int i = 0; i < count; i++)
+	{
+		rows[i]->set_display_mode(get_display_mode());
+		track_label_width(rows[i]);
+	}
+
+	// Stored indices at and after the inserted rows move down
+	for (int i = 0; i < m_selected.size(); i++)
+	{
+		if (m_selected[i] >= index) m_selected[i] += count;
+	}
+	if (m_focusedItem >= index) m_focusedItem += count;
+	if (m_lastSelectedItem >= index) m_lastSelectedItem += count;
+	m_keyFocusPending = -1;
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+}
+
+void Fle_Listview::remove_rows(int first, int count)
+{
+	if (count <= 0) return;
+
+	int last = first + count - 1;
+
+	// Callers like remove_selected() may already be batching
+	bool redraw = (m_state & FLE_LISTVIEW_REDRAW) != 0;
+	set_redraw(false);
+
+	for (int i = first; i <= last; i++)
+	{
+		Fle_Listview_Item* item = m_items[i];
+
+		if (item == m_editedItem) end_label_edit(false);
+		if (item == m_anchorItem) m_anchorItem = nullptr;
+		m_interaction.forget_item(item);
+		untrack_label_width(item);
+
+		if (item->is_selected())
+		{
+			item->set_selected(false);
+			if (when() & FL_WHEN_CHANGED)
+				do_callback_for_item(item, FLE_LISTVIEW_REASON_DESELECTED);
+		}
+	}
+
+	// A hidden focused row passes the focus to the row before it
+	if (m_focusedItem >= first && m_focusedItem <= last)
+	{
+		m_items[m_focusedItem]->set_focus(false);
+		m_focusedItem = first - 1;
+		if (m_focusedItem != -1) m_items[m_focusedItem]->set_focus(true);
+	}
+	else if (m_focusedItem > last)
+	{
+		m_focusedItem -= count;
+	}
+
+	if (m_lastSelectedItem >= first && m_lastSelectedItem <= last) m_lastSelectedItem = -1;
+	else if (m_lastSelectedItem > last) m_lastSelectedItem -= count;
+
+	std::vector<int>::iterator kept = m_selected.begin();
+	for (std::vector<int>::iterator it = m_selected.begin(); it != m_selected.end(); it++)
+	{
+		if (*it >= first && *it <= last) continue;
+
+		*kept++ = *it > last ? *it - count : *it;
+	}
+	m_selected.erase(kept, m_selected.end());
+
+	m_items.erase(m_items.begin() + first, m_items.begin() + last + 1);
+	m_keyFocusPending = -1;
+
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+
+	set_redraw(redraw);
+}
+
+void Fle_Listview::append_tree_rows(std::vector<Fle_Listview_Item*>& rows, Fle_Listview_Item* item) const
+{
+	rows.push_back(item);
+
+	if (!item->m_expanded) return;
+
+	for (int i = 0; i < item->m_children.size(); i++)
+	{
+		append_tree_rows(rows, item->m_children[i]);
+	}
+}
+
+void Fle_Listview::sort_subtree(Fle_Listview_Item* item, const std::function<bool(Fle_Listview_Item*, Fle_Listview_Item*)>& order)
+{
+	std::sort(item->m_children.begin(), item->m_children.end(), order);
+
+	for (int i = 0; i < item->m_children.size(); i++)
+	{
+		sort_subtree(item->m_children[i], order);
+	}
+}
+
+int Fle_Listview::get_cached_label_width(Fle_Listview_Item* item)
+{
+	if (item->m_labelWidth < 0) item->m_labelWidth = item->get_label_width();
+
+	return item->m_labelWidth;
+}
+
+void Fle_Listview::track_label_width(Fle_Listview_Item* item)
+{
+	if (m_labelWidthsValid) m_labelWidths.insert(get_cached_label_width(item));
+}
+
+void Fle_Listview::untrack_label_width(Fle_Listview_Item* item)
+{
+	if (!m_labelWidthsValid) return;
+
+	// Only one of the items with the same width is forgotten
+	std::multiset<int>::iterator it = m_labelWidths.find(item->m_labelWidth);
+	if (it != m_labelWidths.end()) m_labelWidths.erase(it);
+}
+
+void Fle_Listview::build_groups()
+{
+	m_state &= ~FLE_LISTVIEW_NEEDS_GROUPING;
+
+	// Groups that still exist afterwards stay collapsed
+	std::map<std::string, bool> collapsed;
+	for (const Group& group : m_groups)
+		collapsed[group.key] = group.collapsed;
+
+	int count = (int)m_items.size();
+	Fle_Listview_Item* focused = m_focusedItem >= 0 && m_focusedItem < count ? m_items[m_focusedItem] : nullptr;
+	Fle_Listview_Item* lastSelected = m_lastSelectedItem >= 0 && m_lastSelectedItem < count ? m_items[m_lastSelectedItem] : nullptr;
+
+	std::map<std::string, std::vector<Fle_Listview_Item*>> buckets;
+	for (Fle_Listview_Item* item : m_items)
+		buckets[item->get_group()].push_back(item);
+
+	m_items.clear();
+	m_groups.clear();
+
+	for (std::map<std::string, std::vector<Fle_Listview_Item*>>::iterator it = buckets.begin(); it != buckets.end(); it++)
+	{
+		Group group;
+		group.key = it->first;
+		group.first = (int)m_items.size();
+		group.count = (int)it->second.size();
+
+		std::map<std::string, bool>::iterator state = collapsed.find(it->first);
+		group.collapsed = state != collapsed.end() && state->second;
+
+		m_groups.push_back(group);
+		m_items.insert(m_items.end(), it->second.begin(), it->second.end());
+	}
+
+	// Stored indices follow the items to their new positions
+	m_selected.clear();
+	m_focusedItem = -1;
+	m_lastSelectedItem = -1;
+	m_keyFocusPending = -1;
+
+	for (int i = 0; i < count; i++)
+	{
+		Fle_Listview_Item* item = m_items[i];
+
+		if (item->is_selected()) m_selected.push_back(i);
+		if (item == focused) m_focusedItem = i;
+		if (item == lastSelected) m_lastSelectedItem = i;
+	}
+
+	// Row offsets follow the new order once the items are arranged
+	m_groupOffsets.clear();
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+}
+
+void Fle_Listview::update_group_offsets()
+{
+	// Prefix sums of the heights taken by every group, a header and the expanded rows
+	m_groupOffsets.resize(m_groups.size() + 1);
+
+	int offset = 0;
+	for (int g = 0; g < (int)m_groups.size(); g++)
+	{
+		const Group& group = m_groups[g];
+
+		m_groupOffsets[g] = offset;
+		offset += 20;
+		if (!group.collapsed) offset += m_rowIndex->prefix(group.first + group.count) - m_rowIndex->prefix(group.first);
+	}
+	m_groupOffsets[m_groups.size()] = offset;
+}
+
+bool Fle_Listview::rows_grouped() const
+{
+	return (m_state & FLE_LISTVIEW_GROUPED_ROWS) && !(m_state & FLE_LISTVIEW_NEEDS_GROUPING) && get_display_mode() == FLE_LISTVIEW_DISPLAY_DETAILS && m_groupOffsets.size() == m_groups.size() + 1;
+}
+
+int Fle_Listview::find_item_group(int index) const
+{
+	int low = 0;
+	int high = (int)m_groups.size() - 1;
+	while (low < high)
+	{
+		int middle = (low + high + 1) / 2;
+
+		if (m_groups[middle].first <= index)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return low;
+}
+
+int Fle_Listview::get_offset_group(int offset) const
+{
+	// The last entry is the height of all rows, not a group
+	int group = (int)(std::upper_bound(m_groupOffsets.begin(), m_groupOffsets.end() - 1, offset) - m_groupOffsets.begin()) - 1;
+
+	return std::max(0, group);
+}
+
+int Fle_Listview::get_item_at_offset(int offset) const
+{
+	if (offset < 0 || m_rowIndex->size() != (int)m_items.size()) return -1;
+
+	if (!rows_grouped())
+	{
+		int index = m_rowIndex->find(offset);
+
+		return index < (int)m_items.size() ? index : -1;
+	}
+
+	if (m_groups.empty() || offset >= m_groupOffsets.back()) return -1;
+
+	int g = get_offset_group(offset);
+	const Group& group = m_groups[g];
+	int itemsOffset = offset - m_groupOffsets[g] - 20;
+	if (itemsOffset < 0 || group.collapsed) return -1;
+
+	int index = m_rowIndex->find(m_rowIndex->prefix(group.first) + itemsOffset);
+
+	return index < group.first + group.count ? index : -1;
+}
+
+int Fle_Listview::get_item_offset(int index) const
+{
+	if (!rows_grouped()) return m_rowIndex->prefix(index);
+
+	int group = find_item_group(index);
+	if (m_groups[group].collapsed) return m_groupOffsets[group];
+
+	return m_groupOffsets[group] + 20 + m_rowIndex->prefix(index) - m_rowIndex->prefix(m_groups[group].first);
+}
+
+int Fle_Listview::get_rows_height() const
+{
+	if (rows_grouped()) return m_groupOffsets.back();
+
+	return m_rowIndex->total();
+}
+
+void Fle_Listview::place_row(int index) const
+{
+	Fle_Listview_Item* item = m_items[index];
+	item->m_layoutGeneration = m_layoutGeneration;
+
+	// Items of collapsed groups take no area
+	if (rows_grouped() && m_groups[find_item_group(index)].collapsed)
+		item->resize(0, m_gridOriginY + get_item_offset(index), 0, 0);
+	else
+		item->resize(0, m_gridOriginY + get_item_offset(index), m_columnEdges[0], item->m_rowHeight);
+}
+
+void Fle_Listview::update_item_position(int index) const
+{
+	if (get_display_mode() != FLE_LISTVIEW_DISPLAY_DETAILS || index < 0 || index >= m_rowIndex->size()) return;
+	if (m_items[index]->m_layoutGeneration == m_layoutGeneration) return;
+
+	place_row(index);
+}
+
+void Fle_Listview::update_item_position(Fle_Listview_Item* item) const
+{
+	if (item->m_layoutGeneration == m_layoutGeneration) return;
+
+	// The index is looked up only for items the last row height changes moved
+	std::vector<Fle_Listview_Item*>::const_iterator it = std::find(m_items.begin(), m_items.end(), item);
+	if (it != m_items.end()) update_item_position((int)(it - m_items.begin()));
+}
+
+int Fle_Listview::get_group_header_at(int X, int Y) const
+{
+	if (!rows_grouped() || Y < y() + m_headersHeight) return -1;
+
+	int cellX = X - x() - m_margin + m_hscrollbar.value();
+	int cellY = Y - y() - m_margin + m_vscrollbar.value() - m_gridOriginY;
+	if (cellX < 0 || cellX >= m_columnEdges[0] || cellY < 0) return -1;
+	if (m_groups.empty() || cellY >= m_groupOffsets.back()) return -1;
+
+	int group = get_offset_group(cellY);
+
+	return cellY < m_groupOffsets[group] + 20 ? group : -1;
+}
+
+void Fle_Listview::set_row_height(int index, int height)
+{
+	if (index < 0 || index >= (int)m_items.size()) return;
+
+	Fle_Listview_Item* item = m_items[index];
+	int delta = std::max(1, height) - item->m_rowHeight;
+	if (delta == 0) return;
+
+	item->m_rowHeight += delta;
+
+	if (get_display_mode() != FLE_LISTVIEW_DISPLAY_DETAILS) return;
+
+	if ((m_state & FLE_LISTVIEW_NEEDS_ARRANGING) || m_rowIndex->size() != (int)m_items.size())
+	{
+		m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+		listview_redraw();
+		return;
+	}
+
+	// The rows after the changed one move, they are placed again when needed
+	m_rowIndex->add(index, delta);
+	if (rows_grouped()) update_group_offsets();
+	m_layoutGeneration++;
+	place_row(index);
+
+	m_itemsBBoxY = m_gridOriginY + get_rows_height();
+	m_interaction.hitValid = false;
+
+	if (m_editedItem) place_label_editor();
+
+	update_scrollbars();
+	listview_redraw();
+}
+
+int Fle_Listview::get_row_height(int index) const
+{
+	return m_items[index]->m_rowHeight;
+}
+
+int Fle_Listview::next_shown_item(int index, int direction) const
+{
+	if (!rows_grouped()) return index;
+
+	while (index >= 0 && index < (int)m_items.size())
+	{
+		const Group& group = m_groups[find_item_group(index)];
+		if (!group.collapsed) return index;
+
+		index = direction > 0 ? group.first + group.count : group.first - 1;
+	}
+
+	return index;
+}
+
+void Fle_Listview::draw_group_headers()
+{
+	int top = m_vscrollbar.value() - m_margin - m_gridOriginY;
+	int bottom = top + h() - 1;
+
+	// Headers stay in view when pinned columns do
+	int X = x() + m_margin - (m_pinnedColumns > 0 ? 0 : m_hscrollbar.value());
+	int Y = y() + m_margin - m_vscrollbar.value() + m_gridOriginY;
+	int W = m_columnEdges[0];
+
+	fl_font(labelfont() | FL_BOLD, labelsize());
+	for (int g = get_offset_group(std::max(0, top)); g < (int)m_groups.size() && m_groupOffsets[g] <= bottom; g++)
+	{
+		if (m_groupOffsets[g] + 20 <= top) continue;
+
+		const Group& group = m_groups[g];
+		int headerY = Y + m_groupOffsets[g];
+		std::string text = group.key + " (" + std::to_string(group.count) + ")";
+
+		fl_rectf(X, headerY, W, 20, color());
+		fl_color(labelcolor());
+		fl_draw(group.collapsed ? "@-3>" : "@-32>", X, headerY, 16, 20, FL_ALIGN_CENTER, nullptr, 1);
+		fl_draw(text.c_str(), X + 18, headerY, W - 18, 20, FL_ALIGN_LEFT | FL_ALIGN_CLIP);
+
+		int textW = 0, textH = 0;
+		fl_measure(text.c_str(), textW, textH);
+		fl_color(FL_DARK3);
+		if (X + 24 + textW < X + W - 4)
+			fl_xyline(X + 24 + textW, headerY + 10, X + W - 4);
+	}
+	fl_font(labelfont(), labelsize());
+}
+
+void Fle_Listview::grouped_rows(bool grouped)
+{
+	if (grouped == grouped_rows()) return;
+
+	if (grouped)
+	{
+		m_state |= FLE_LISTVIEW_GROUPED_ROWS | FLE_LISTVIEW_NEEDS_GROUPING;
+		m_state &= ~FLE_LISTVIEW_TREE_LIST;
+	}
+	else
+	{
+		m_state &= ~(FLE_LISTVIEW_GROUPED_ROWS | FLE_LISTVIEW_NEEDS_GROUPING);
+		m_groups.clear();
+		m_groupOffsets.clear();
+	}
+
+	end_label_edit(true);
+	m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+	listview_redraw();
+}
+
+void Fle_Listview::regroup_items()
+{
+	if (!grouped_rows()) return;
+
+	end_label_edit(true);
+	m_state |= FLE_LISTVIEW_NEEDS_GROUPING | FLE_LISTVIEW_NEEDS_ARRANGING;
+	listview_redraw();
+}
+
+int Fle_Listview::get_group_count()
+{
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+
+	return (int)m_groups.size();
+}
+
+const std::string& Fle_Listview::get_group_key(int group)
+{
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+
+	return m_groups[group].key;
+}
+
+void Fle_Listview::get_group_items(int group, int& first, int& count)
+{
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+
+	first = m_groups[group].first;
+	count = m_groups[group].count;
+}
+
+int Fle_Listview::get_item_group(int index)
+{
+	if (!grouped_rows()) return -1;
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+
+	return find_item_group(index);
+}
+
+void Fle_Listview::set_group_collapsed(int group, bool collapsed)
+{
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+	if (group < 0 || group >= (int)m_groups.size() || m_groups[group].collapsed == collapsed) return;
+
+	end_label_edit(true);
+	m_groups[group].collapsed = collapsed;
+
+	if (get_display_mode() != FLE_LISTVIEW_DISPLAY_DETAILS) return;
+
+	if ((m_state & FLE_LISTVIEW_NEEDS_ARRANGING) || !rows_grouped() || m_rowIndex->size() != (int)m_items.size())
+	{
+		m_state |= FLE_LISTVIEW_NEEDS_ARRANGING;
+		listview_redraw();
+		return;
+	}
+
+	// The items stay in place, only the rows after the group move. They are
+	// placed again when needed, as with row height changes.
+	update_group_offsets();
+	m_layoutGeneration++;
+
+	m_itemsBBoxY = m_gridOriginY + get_rows_height();
+	m_interaction.hitValid = false;
+
+	int maxScroll = std::max(0, m_itemsBBoxY - h() + (2 * m_margin) + (m_hscrollbar.visible() ? Fl::scrollbar_size() : 0));
+	if (m_vscrollbar.value() > maxScroll) m_vscrollbar.value(maxScroll);
+
+	update_scrollbars();
+	listview_redraw();
+}
+
+bool Fle_Listview::is_group_collapsed(int group)
+{
+	if (m_state & FLE_LISTVIEW_NEEDS_GROUPING) build_groups();
+
+	return m_groups[group].collapsed;
+}
+
+void Fle_Listview::resize(int X, int Y, int W, int H)
+{
+	end_label_edit(true);
+
+	save_anchor();
+
 	Fl_Widget::resize(X, Y, W, H);
 
 	arrange_items();
@@ -0,0 +1,411 @@
+#include <FLE/Fle_Listview_Csv_Source.hpp>
+
+#include <FL/fl_draw.H>
+
+#include <cstring>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Read-only mapping of a whole file, shared by the source and it's items
+class Fle_Csv_Mapping
+{
+public:
+	const char* m_data;
+	size_t m_size;
+	char m_separator;
+
+	Fle_Csv_Mapping()
+	{
+		m_data = nullptr;
+		m_size = 0;
+		m_separator = ',';
+	}
+
+	~Fle_Csv_Mapping()
+	{
+		if (!m_data) return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+#else
+		munmap((void*)m_data, m_size);
+#endif
+	}
+
+	bool map(const char* path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size))
+		{
+			m_size = (size_t)size.QuadPart;
+
+			// The view stays valid after both handles are closed
+			HANDLE mapping = m_size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+			if (mapping)
+			{
+				m_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+#else
+		int fd = ::open(path, O_RDONLY);
+		if (fd == -1) return false;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0)
+		{
+			m_size = (size_t)st.st_size;
+
+			// The mapping stays valid after the file is closed
+			void* data = m_size > 0 ? mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+			if (data != MAP_FAILED) m_data = (const char*)data;
+		}
+		::close(fd);
+#endif
+
+		if (!m_data) m_size = 0;
+
+		return m_data != nullptr;
+	}
+};
+
+// Finds the line break ending the row that starts at pos, or the end of the
+// data. Line breaks inside quotes don't end the row. Both searches use memchr,
+// which the C libraries vectorise.
+static size_t find_row_end(const char* data, size_t size, size_t pos)
+{
+	bool quoted = false;
+
+	for (;;)
+	{
+		const char* lineBreak = (const char*)memchr(data + pos, '\n', size - pos);
+		size_t lineEnd = lineBreak ? lineBreak - data : size;
+
+		// An odd number of quotes leaves the row inside a quoted cell
+		const char* quote = data + pos;
+		while ((quote = (const char*)memchr(quote, '"', data + lineEnd - quote)) != nullptr)
+		{
+			quoted = !quoted;
+			quote++;
+		}
+
+		if (!quoted || lineEnd == size) return lineEnd;
+
+		pos = lineEnd + 1;
+	}
+}
+
+// Reads the cell starting at pos in a row ending at end. Returns the offset of
+// the next cell, or end + 1 after the last cell.
+static size_t read_cell(const char* data, size_t pos, size_t end, char separator, const char*& text, size_t& length)
+{
+	if (pos < end && data[pos] == '"')
+	{
+		// A doubled quote is part of the cell, a single one closes it
+		size_t close = pos + 1;
+		for (;;)
+		{
+			const char* quote = (const char*)memchr(data + close, '"', end - close);
+			if (!quote)
+			{
+				close = end;
+				break;
+			}
+
+			close = quote - data;
+			if (close + 1 < end && data[close + 1] == '"')
+			{
+				close += 2;
+				continue;
+			}
+			break;
+		}
+
+		text = data + pos + 1;
+		length = close - pos - 1;
+
+		const char* next = close < end ? (const char*)memchr(data + close, separator, end - close) : nullptr;
+		return next ? next - data + 1 : end + 1;
+	}
+
+	const char* next = (const char*)memchr(data + pos, separator, end - pos);
+	size_t cellEnd = next ? next - data : end;
+
+	text = data + pos;
+	length = cellEnd - pos;
+
+	return cellEnd + 1;
+}
+
+// Finds a cell of a row without copying it
+static bool find_cell(const Fle_Csv_Mapping& mapping, size_t begin, size_t end, int column, const char*& text, size_t& length)
+{
+	size_t pos = begin;
+
+	for (int i = 0; pos <= end; i++)
+	{
+		size_t next = read_cell(mapping.m_data, pos, end, mapping.m_separator, text, length);
+		if (i == column) return true;
+
+		pos = next;
+	}
+
+	return false;
+}
+
+// Copies a cell, replacing doubled quotes by single ones
+static std::string copy_cell(const Fle_Csv_Mapping& mapping, size_t begin, size_t end, int column)
+{
+	const char* text;
+	size_t length;
+	if (!find_cell(mapping, begin, end, column, text, length)) return std::string();
+
+	std::string cell;
+	cell.reserve(length);
+	for (size_t i = 0; i < length; i++)
+	{
+		cell += text[i];
+		if (text[i] == '"' && i + 1 < length && text[i + 1] == '"') i++;
+	}
+
+	return cell;
+}
+
+// Parses a cell that is a number and nothing else
+static bool parse_number(const char* text, size_t length, double& value)
+{
+	char buffer[64];
+	if (length == 0 || length >= sizeof(buffer)) return false;
+
+	memcpy(buffer, text, length);
+	buffer[length] = '\0';
+
+	char* parsed;
+	value = strtod(buffer, &parsed);
+
+	return parsed == buffer + length;
+}
+
+Fle_Listview_Csv_Item::Fle_Listview_Csv_Item(std::shared_ptr<const Fle_Csv_Mapping> mapping, size_t begin, size_t end) :
+	Fle_Listview_Item(copy_cell(*mapping, begin, end, 0).c_str())
+{
+	m_mapping = std::move(mapping);
+	m_begin = begin;
+	m_end = end;
+}
+
+bool Fle_Listview_Csv_Item::get_cell(int column, const char*& text, size_t& length) const
+{
+	return find_cell(*m_mapping, m_begin, m_end, column, text, length);
+}
+
+std::string Fle_Listview_Csv_Item::get_cell_text(int column) const
+{
+	return copy_cell(*m_mapping, m_begin, m_end, column);
+}
+
+std::string Fle_Listview_Csv_Item::get_property_text(int property) const
+{
+	return get_cell_text(property + 1);
+}
+
+bool Fle_Listview_Csv_Item::is_greater(Fle_Listview_Item* other, int property)
+{
+	if (property == -1) return Fle_Listview_Item::is_greater(other, property);
+
+	// Items of other kinds may share the listview
+	Fle_Listview_Csv_Item* o = dynamic_cast<Fle_Listview_Csv_Item*>(other);
+	if (!o) return Fle_Listview_Item::is_greater(other, property);
+
+	const char* text = "";
+	const char* otherText = "";
+	size_t length = 0;
+	size_t otherLength = 0;
+	get_cell(property + 1, text, length);
+	o->get_cell(property + 1, otherText, otherLength);
+
+	double value, otherValue;
+	if (parse_number(text, length, value) && parse_number(otherText, otherLength, otherValue))
+		return value > otherValue;
+
+	int order = memcmp(text, otherText, std::min(length, otherLength));
+	return order > 0 || (order == 0 && length > otherLength);
+}
+
+void Fle_Listview_Csv_Item::draw_property(int property, int X, int Y, int W, int H)
+{
+	const char* text;
+	size_t length;
+	if (!get_cell(property + 1, text, length)) return;
+
+	fl_color(textcolor());
+
+	// Only cells with doubled quotes have to be copied
+	if (memchr(text, '"', length))
+	{
+		fl_draw(get_cell_text(property + 1).c_str(), X, Y, W, H, FL_ALIGN_LEFT | FL_ALIGN_CLIP);
+		return;
+	}
+
+	// Text this far past the column is clipped anyway
+	int count = (int)std::min(length, (size_t)512);
+
+	fl_push_clip(X, Y, W, H);
+	fl_draw(text, count, X, Y + (H - fl_height()) / 2 + fl_height() - fl_descent());
+	fl_pop_clip();
+}
+
+Fle_Listview_Csv_Source::Fle_Listview_Csv_Source(Fle_Listview* listview)
+{
+	m_listview = listview;
+	m_stopping = false;
+	m_indexing = false;
+	m_rowCount = 0;
+	m_columnCount = 0;
+	m_firstRow = 0;
+	m_opened = false;
+}
+
+Fle_Listview_Csv_Source::~Fle_Listview_Csv_Source()
+{
+	close();
+}
+
+bool Fle_Listview_Csv_Source::open(const char* path, char separator, bool header)
+{
+	// The listview keeps the columns and rows of the first file
+	assert(!m_opened && "Fle_Listview_Csv_Source opens only one file");
+	if (m_opened) return false;
+
+	std::shared_ptr<Fle_Csv_Mapping> mapping = std::make_shared<Fle_Csv_Mapping>();
+	if (!mapping->map(path)) return false;
+
+	const char* data = mapping->m_data;
+	size_t size = mapping->m_size;
+	m_opened = true;
+
+	// A UTF-8 byte order mark isn't part of the first cell
+	size_t start = 0;
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) start = 3;
+
+	size_t firstEnd = find_row_end(data, size, start);
+	size_t firstNext = firstEnd + 1;
+	if (firstEnd > start && data[firstEnd - 1] == '\r') firstEnd--;
+
+	if (separator == 0) separator = memchr(data + start, '\t', firstEnd - start) ? '\t' : ',';
+	mapping->m_separator = separator;
+
+	std::vector<std::string> headers;
+	m_columnCount = 0;
+	while (true)
+	{
+		const char* text;
+		size_t length;
+		if (!find_cell(*mapping, start, firstEnd, m_columnCount, text, length)) break;
+
+		if (header) headers.push_back(copy_cell(*mapping, start, firstEnd, m_columnCount));
+		else headers.push_back("Column " + std::to_string(m_columnCount + 1));
+
+		m_columnCount++;
+	}
+
+	m_listview->set_name_text(headers[0]);
+
+	// Property order index 0 is the rightmost column
+	std::vector<int> order;
+	for (int i = 1; i < m_columnCount; i++)
+	{
+		m_listview->add_property_name(headers[i]);
+		order.insert(order.begin(), i - 1);
+	}
+	m_listview->set_property_widths(std::vector<int>(m_columnCount - 1, 100));
+	m_listview->set_property_order(order);
+
+	m_mapping = mapping;
+	m_firstRow = header ? firstNext : start;
+	m_rowCount = 0;
+	m_stopping = false;
+	m_indexing = true;
+
+	// Items are made on the indexer thread, the default icons they share
+	// have to exist before it starts
+	Fle_Listview_Item::create_default_icons();
+	m_indexer = std::thread(&Fle_Listview_Csv_Source::index_rows, this);
+
+	return true;
+}
+
+void Fle_Listview_Csv_Source::close()
+{
+	if (m_indexer.joinable())
+	{
+		m_stopping = true;
+		m_indexer.join();
+	}
+
+	m_indexing = false;
+	m_mapping.reset();
+}
+
+void Fle_Listview_Csv_Source::index_rows()
+{
+	const char* data = m_mapping->m_data;
+	size_t size = m_mapping->m_size;
+	size_t pos = m_firstRow;
+
+	while (pos < size && !m_stopping.load(std::memory_order_relaxed))
+	{
+		size_t end = find_row_end(data, size, pos);
+		size_t next = end + 1;
+		if (end > pos && data[end - 1] == '\r') end--;
+
+		// Blank lines aren't rows
+		if (end > pos)
+		{
+			m_listview->post_item(new Fle_Listview_Csv_Item(m_mapping, pos, end));
+			m_rowCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		pos = next;
+	}
+
+	m_indexing = false;
+}
+
+bool Fle_Listview_Csv_Source::is_indexing() const
+{
+	return m_indexing;
+}
+
+int Fle_Listview_Csv_Source::get_row_count() const
+{
+	return m_rowCount;
+}
+
+int Fle_Listview_Csv_Source::get_column_count() const
+{
+	return m_columnCount;
+}
+
+char Fle_Listview_Csv_Source::get_separator() const
+{
+	return m_mapping ? m_mapping->m_separator : 0;
+}
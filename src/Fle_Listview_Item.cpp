@@ -6,6 +6,8 @@
 
 #include <FLE/Fle_Listview.hpp>
 
+#include <cstring>
+
 static char* default_icon_small[] = {
 "16 16 3 1",
 " 	c None",
@@ -77,17 +79,50 @@ Fle_Listview_Item::Fle_Listview_Item(const char* name)
 	m_name = name;
 	m_textcolor = FL_FOREGROUND_COLOR;
 	m_bgcolor = 0xFFFFFFFF;
+	m_listview = nullptr;
+	m_postNext = nullptr;
+	m_treeParent = nullptr;
+	m_treeDepth = 0;
+	m_expandable = false;
+	m_expanded = false;
+	m_childrenLoaded = false;
+	m_x = 0;
+	m_y = 0;
+	m_w = 0;
+	m_h = 0;
 	set_display_mode(FLE_LISTVIEW_DISPLAY_LIST);
 
-	if (!defaultImgSmall) defaultImgSmall = new Fl_Pixmap(default_icon_small);
-	if (!defaultImgBig) defaultImgBig = new Fl_Pixmap(default_icon_big);
+	create_default_icons();
 
 	m_smallIcon = defaultImgSmall;
 	m_bigIcon = defaultImgBig;
+	m_loadedSmallIcon = nullptr;
+	m_loadedBigIcon = nullptr;
+	m_iconRequests = 0;
+	m_labelWidth = -1;
+	m_rowHeight = 20;
+	m_layoutGeneration = 0;
 
 	set_display_name();
 }
 
+Fle_Listview_Item::~Fle_Listview_Item()
+{
+	delete m_loadedSmallIcon;
+	delete m_loadedBigIcon;
+
+	for (int i = 0; i < m_children.size(); i++)
+	{
+		delete m_children[i];
+	}
+}
+
+void Fle_Listview_Item::create_default_icons()
+{
+	if (!defaultImgSmall) defaultImgSmall = new Fl_Pixmap(default_icon_small);
+	if (!defaultImgBig) defaultImgBig = new Fl_Pixmap(default_icon_big);
+}
+
 void Fle_Listview_Item::set_display_name()
 {
 	m_displayName = m_name;
@@ -251,6 +286,88 @@ const std::string &Fle_Listview_Item::get_tooltip() const
     return m_tooltip.empty() ? m_name : m_tooltip;
 }
 
+void Fle_Listview_Item::set_icon_key(std::string key)
+{
+	m_iconKey = std::move(key);
+}
+
+const std::string &Fle_Listview_Item::get_icon_key() const
+{
+	return m_iconKey.empty() ? m_name : m_iconKey;
+}
+
+void Fle_Listview_Item::set_row_height(int height)
+{
+	m_rowHeight = height < 1 ? 1 : height;
+}
+
+int Fle_Listview_Item::get_row_height() const
+{
+	return m_rowHeight;
+}
+
+void Fle_Listview_Item::set_expandable(bool expandable)
+{
+	m_expandable = expandable || !m_children.empty();
+}
+
+bool Fle_Listview_Item::is_expandable() const
+{
+	return m_expandable;
+}
+
+bool Fle_Listview_Item::is_expanded() const
+{
+	return m_expanded;
+}
+
+Fle_Listview_Item* Fle_Listview_Item::get_parent_item() const
+{
+	return m_treeParent;
+}
+
+int Fle_Listview_Item::get_depth() const
+{
+	return m_treeDepth;
+}
+
+int Fle_Listview_Item::get_child_count() const
+{
+	return (int)m_children.size();
+}
+
+Fle_Listview_Item* Fle_Listview_Item::get_child(int index) const
+{
+	return m_children[index];
+}
+
+int Fle_Listview_Item::get_tree_indent() const
+{
+	if (m_displayMode != FLE_LISTVIEW_DISPLAY_DETAILS || !m_listview || !m_listview->tree_list()) return 0;
+
+	return (m_treeDepth + 1) * 16;
+}
+
+void Fle_Listview_Item::set_group(std::string group)
+{
+	m_group = std::move(group);
+}
+
+const std::string &Fle_Listview_Item::get_group() const
+{
+	return m_group;
+}
+
+Fl_Image* Fle_Listview_Item::get_draw_icon(bool big) const
+{
+	if (big)
+	{
+		return m_loadedBigIcon ? m_loadedBigIcon : m_listview->get_cached_icon(m_bigIcon);
+	}
+
+	return m_loadedSmallIcon ? m_loadedSmallIcon : m_listview->get_cached_icon(m_smallIcon);
+}
+
 int Fle_Listview_Item::get_label_width() const
 {
 	fl_font(get_listview()->labelfont(), get_listview()->labelsize());
@@ -307,15 +424,23 @@ void Fle_Listview_Item::draw_item(int index)
 	// Draw icon
 	if (m_displayMode == FLE_LISTVIEW_DISPLAY_ICONS)
 	{
-		m_bigIcon->draw(x() + 21, y());
+		get_draw_icon(true)->draw(x() + 21, y());
 	}
 	else if(m_displayMode == FLE_LISTVIEW_DISPLAY_TOOLBOX)
 	{
-		m_bigIcon->draw(x(), y());
+		get_draw_icon(true)->draw(x(), y());
 	}
 	else
 	{
-		m_smallIcon->draw(x(), y() + 2);
+		int indent = get_tree_indent();
+
+		if (indent > 0 && m_expandable)
+		{
+			fl_color(textcolor());
+			fl_draw(m_expanded ? "@-32>" : "@-3>", x() + indent - 16, y(), 16, 20, FL_ALIGN_CENTER, nullptr, 1);
+		}
+
+		get_draw_icon(false)->draw(x() + indent, y() + 2);
 	}
 
 	// Draw text
@@ -330,9 +455,11 @@ void Fle_Listview_Item::draw_item(int index)
 	{
 		Fl_Align align = FL_ALIGN_LEFT | FL_ALIGN_INSIDE | FL_ALIGN_CLIP;
 
-		if (m_listview->get_item_column_width() != 0 && get_label_width() + 16 > m_listview->get_item_column_width())
+		int indent = get_tree_indent();
+
+		if (m_listview->get_item_column_width() != 0 && get_label_width() + 16 + indent > m_listview->get_item_column_width())
 		{
-			textW = m_listview->get_item_column_width() - 32;
+			textW = m_listview->get_item_column_width() - 32 - indent;
 			fl_draw("...", textX + textW, textY, 16, textH, align);
 		}
 
@@ -344,26 +471,27 @@ void Fle_Listview_Item::draw_item(int index)
 		if(detailsMode == 1 && index != m_listview->get_item_count() - 1)
 		{
 			fl_color(FL_INACTIVE_COLOR);
-			fl_line(x() + 2, y() + 19, x() + w() - 4, y() + 19);
+			fl_line(x() + 2, y() + h() - 1, x() + w() - 4, y() + h() - 1);
 		}
 
 		const std::vector<int>& props = m_listview->get_property_order();
 
-		int prevWidth = 0;
+		// Only the columns scrolled into view are drawn
+		int first, last;
+		m_listview->get_visible_properties(first, last);
 
-		for (int i : props)
+		for (int i = first; i <= last; i++)
 		{
-			int width = m_listview->get_property_header_width(i);
+			int width = m_listview->get_property_header_width(props[i]);
+			int propX = x() + m_listview->get_property_x(i);
 
 			if (detailsMode == 1)
 			{
 				fl_color(FL_INACTIVE_COLOR);
-				fl_line(x() + w() - width - prevWidth, y(), x() + w() - width - prevWidth, y() + h() - 1);
+				fl_line(propX, y(), propX, y() + h() - 1);
 			}
 
-			draw_property(i, x() + w() - prevWidth - width + 4, y(), width, h());
-
-			prevWidth += width;
+			draw_property(props[i], propX + 4, y(), width, h());
 		}
 	}
 }
@@ -379,7 +507,9 @@ bool Fle_Listview_Item::is_inside_drag_area(int X, int Y)
 		return X >= x() && X <= x() + w() && Y >= y() && Y <= y() + h();
 	}
 
-	return X >= x() && X <= x() + get_label_width() + 16 && Y >= y() && Y <= y() + h();
+	int indent = get_tree_indent();
+
+	return X >= x() + indent && X <= x() + indent + get_label_width() + 16 && Y >= y() && Y <= y() + h();
 }
 void Fle_Listview_Item::get_text_xywh(int& X, int& Y, int& W, int& H)
 {
@@ -408,8 +538,10 @@ void Fle_Listview_Item::get_text_xywh(int& X, int& Y, int& W, int& H)
 	}
 	else
 	{
-		X += 16;
-		W -= 16;
+		int indent = get_tree_indent();
+
+		X += 16 + indent;
+		W -= 16 + indent;
 
 		if (m_displayMode == FLE_LISTVIEW_DISPLAY_DETAILS && m_listview->get_details_mode() == 1)
 		{
@@ -423,12 +555,54 @@ void Fle_Listview_Item::draw_property(int property, int X, int Y, int W, int H)
 {
 }
 
+std::string Fle_Listview_Item::get_property_text(int property) const
+{
+	return std::string();
+}
+
+void Fle_Listview_Item::append_dnd_data(std::string& payload, Fle_Listview_Dnd_Format format) const
+{
+	if (format != FLE_LISTVIEW_DND_URI_LIST)
+	{
+		payload += m_name;
+		return;
+	}
+
+	// A relative name can't be made into a URI, the item is left out
+	bool rooted = !m_name.empty() && (m_name[0] == '/' || m_name[0] == '\\');
+	char letter = m_name.empty() ? 0 : m_name[0];
+	bool drive = m_name.size() >= 3 && ((letter >= 'a' && letter <= 'z') || (letter >= 'A' && letter <= 'Z')) && m_name[1] == ':' && (m_name[2] == '/' || m_name[2] == '\\');
+	if (!rooted && !drive) return;
+
+	static const char hex[] = "0123456789ABCDEF";
+
+	payload += "file://";
+	if (drive) payload += '/';
+
+	// Bytes other than unreserved characters and path separators are percent-encoded
+	for (int i = 0; i < m_name.size(); i++)
+	{
+		unsigned char c = m_name[i];
+
+		if (c == '\\')
+			payload += '/';
+		else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c != 0 && strchr("-._~/:", c)))
+			payload += (char)c;
+		else
+		{
+			payload += '%';
+			payload += hex[c >> 4];
+			payload += hex[c & 15];
+		}
+	}
+}
+
 int Fle_Listview_Item::x() const
 {
-	return m_x + m_listview->x() + m_listview->get_margin() - m_listview->m_hscrollbar.value();
+	return m_x + m_listview->x() + m_listview->get_margin() - m_listview->m_hscrollbar.value() + m_listview->m_itemDrawOffsetX;
 }
 
 int Fle_Listview_Item::y() const
 {
-	return m_y + m_listview->y() + m_listview->get_margin() - m_listview->m_vscrollbar.value();
+	return m_y + m_listview->y() + m_listview->get_margin() - m_listview->m_vscrollbar.value() + m_listview->m_itemDrawOffsetY;
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include <FLE/Fle_Stack.hpp>
+#include <FLE/Fle_Frame_Scheduler.hpp>
+#include <FLE/Fle_Instrumentation.hpp>
 
 #include <FL/Fl_Window.H>
 
@@ -11,6 +13,19 @@ Fle_Stack::Fle_Stack(int X, int Y, int W, int H, Fle_Stack_Orientation direction
     end();
 }
 
+Fle_Stack::~Fle_Stack()
+{
+    Fle_Frame_Scheduler::cancel(this);
+}
+
+void Fle_Stack::frame_cb(void* data, int work)
+{
+    Fle_Stack* stack = (Fle_Stack*)data;
+
+    if (work & FLE_FRAME_LAYOUT) stack->position_children();
+    if (work & FLE_FRAME_PAINT) stack->redraw();
+}
+
 void Fle_Stack::on_remove(int index)
 {
     int removedSize = get_widget_actual_size(index);
@@ -73,6 +88,9 @@ void Fle_Stack::position_children()
 {
     if(children() == 0) return;
 
+    FLE_INSTRUMENT_SCOPE("Fle_Stack::position_children");
+    FLE_INSTRUMENT_COUNT("Fle_Stack::position_children children", children());
+
     int availableSpace = h();
     if(m_orientation == FLE_STACK_HORIZONTAL)
     {
@@ -358,8 +376,9 @@ int Fle_Stack::handle(int e)
             }
 
             update_preferred_sizes();
-            position_children();
-            redraw();
+
+            // Drag events arriving faster than frames are positioned once
+            Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT | FLE_FRAME_PAINT);
 
             offset = Fl::event_y();
             if (m_orientation == FLE_STACK_HORIZONTAL)
@@ -382,7 +401,7 @@ int Fle_Stack::handle(int e)
 void Fle_Stack::resize(int X, int Y, int W, int H)
 {
     Fl_Group::resize(X, Y, W, H);
-    position_children();
+    Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT);
 }
 
 bool Fle_Stack::add(Fl_Widget* widget, int minSize, int preferredSize, int maxSize)
@@ -398,8 +417,7 @@ bool Fle_Stack::insert(Fl_Widget* widget, int index, int minSize, int preferredS
 
     Fl_Group::insert(*widget, index);
     
-    position_children();
-    redraw();
+    Fle_Frame_Scheduler::schedule(frame_cb, this, FLE_FRAME_LAYOUT | FLE_FRAME_PAINT);
     return true;
 }
 
@@ -1,4 +1,5 @@
 #include <FLE/Fle_TileEx.hpp>
+#include <FLE/Fle_Instrumentation.hpp>
 
 #include <FL/Fl_Window.H>
 #include <FL/fl_draw.H>
@@ -36,7 +37,13 @@ public:
     Edge* m_rightEdge;
     Edge* m_bottomEdge;
 
-    EdgeList() {}
+    EdgeList()
+    {
+        m_leftEdge = nullptr;
+        m_topEdge = nullptr;
+        m_rightEdge = nullptr;
+        m_bottomEdge = nullptr;
+    }
 
     void add_edge(Edge edge)
     {
@@ -326,6 +333,9 @@ void Fle_TileEx::get_max_changes_for_edge(Edge* edge, bool resizingWindow, int&
 void Fle_TileEx::propagate_resize(Edge* edge, int& delta, bool resizingWindow, Edge* previousEdge)
 {
     if(edge == nullptr) return;
+
+    // Recursive calls show up nested in the trace
+    FLE_INSTRUMENT_SCOPE("Fle_TileEx::propagate_resize");
     //std::cout << "propagate resize " << edge->position << " " << delta << std::endl;
     assert(edge->position >= 0);
 
@@ -348,7 +358,8 @@ void Fle_TileEx::propagate_resize(Edge* edge, int& delta, bool resizingWindow, E
     }
     else
     {
-        if(maxShrinkLeftOrTop < maxGrowRightOrBottom)
+        // On a tie prefer the shrinking side, the other one leads back to the caller and the rest of the delta would be lost
+        if(maxShrinkLeftOrTop <= maxGrowRightOrBottom)
         {
             maxChange = maxShrinkLeftOrTop;
         }
@@ -375,7 +386,8 @@ void Fle_TileEx::propagate_resize(Edge* edge, int& delta, bool resizingWindow, E
         if(nextToProcess == previousEdge) return;
         propagate_resize(nextToProcess, delta, resizingWindow, edge);
         oldDelta -= delta;
-        propagate_resize(edge, oldDelta, resizingWindow, edge);
+        // Retry with the freed amount, still never going back to the caller which has already moved
+        propagate_resize(edge, oldDelta, resizingWindow, previousEdge);
     }
 }
 